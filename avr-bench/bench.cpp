@@ -0,0 +1,330 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Benchmark firmware for the esp-link client on the AVR.
+ *
+ * The client runs on a transport that reads from and writes to RAM, so that only the work of the
+ * client itself is measured and not the time the uart needs. Timer 1 runs at the CPU clock and counts
+ * the cycles of every single frame that is encoded or decoded. The results are written to USART0 as lines
+ *
+ *     @bench <name> <frames> <bytes> <cycles>
+ *
+ * after which the firmware puts the CPU to sleep with interrupts disabled, which ends a simavr run.
+ *
+ * One of BENCH_ENCODE, BENCH_DECODE or BENCH_CALLBACK selects which benchmarks are built into
+ * the image, so that the footprint of every image shows what that part of the client costs.
+ */
+#include "esp-link/client.hpp"
+#include "timing/clock.hpp"
+#include <avr_utilities/flash_string.hpp>
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <stdlib.h>
+#include <string.h>
+
+IMPLEMENT_TIMER0_CLOCK_INTERRUPT();
+
+namespace
+{
+    /// number of times that every benchmark is repeated.
+    constexpr uint8_t repetitions = 16;
+
+    /**
+     * Transport that receives from a buffer in RAM and that keeps the first bytes that are sent.
+     */
+    class memory_transport
+    {
+    public:
+        void send( uint8_t value)
+        {
+            if (m_sent < sizeof m_output) m_output[m_sent] = value;
+            ++m_sent;
+        }
+
+        bool data_available() const
+        {
+            return m_position < m_size;
+        }
+
+        uint8_t read()
+        {
+            return m_input[m_position++];
+        }
+
+        uint8_t get()
+        {
+            return data_available() ? read() : 0;
+        }
+
+        /// make bytes available for reading by the client.
+        void feed( const uint8_t *input, uint8_t size)
+        {
+            m_input = input;
+            m_size = size;
+            m_position = 0;
+        }
+
+        /// number of bytes sent since the last call to clear(). Only the first bytes are kept.
+        uint8_t sent() const
+        {
+            return m_sent < sizeof m_output ? m_sent : sizeof m_output;
+        }
+
+        const uint8_t *output() const
+        {
+            return m_output;
+        }
+
+        void clear()
+        {
+            m_sent = 0;
+        }
+
+    private:
+        const uint8_t   *m_input = nullptr;
+        uint8_t         m_size = 0;
+        uint8_t         m_position = 0;
+        uint16_t        m_sent = 0;
+        uint8_t         m_output[128];
+    };
+
+    memory_transport transport;
+    esp_link::basic_client<memory_transport> esp( transport);
+
+    /**
+     * Cycle counter on timer 1, which runs without prescaler. A measurement that
+     * takes 64k cycles or more can not be counted and returns 0xffff.
+     */
+    struct cycle_counter
+    {
+        static void init()
+        {
+            TCCR1A = 0;
+            TCCR1B = _BV( CS10);
+        }
+
+        static void start()
+        {
+            TCNT1 = 0;
+            TIFR1 = _BV( TOV1);
+        }
+
+        static uint16_t stop()
+        {
+            const uint16_t count = TCNT1;
+            return (TIFR1 & _BV( TOV1)) ? 0xffff : count;
+        }
+    };
+
+    /// cycles that a measurement of nothing takes.
+    uint16_t overhead = 0;
+
+    void uart_init()
+    {
+        constexpr uint16_t ubrr = F_CPU / 16 / 19200 - 1;
+        UBRR0H = ubrr >> 8;
+        UBRR0L = ubrr;
+        UCSR0B = _BV( TXEN0);
+        UCSR0C = _BV( UCSZ01) | _BV( UCSZ00);
+    }
+
+    void put( char c)
+    {
+        while (!(UCSR0A & _BV( UDRE0))) {}
+        UDR0 = c;
+    }
+
+    void put( const char *string)
+    {
+        while (*string) put( *string++);
+    }
+
+    void put_P( const char *string)
+    {
+        while (char c = pgm_read_byte( string++)) put( c);
+    }
+
+    void put_number( uint32_t value)
+    {
+        char buffer[11];
+        put( ' ');
+        put( ultoa( value, buffer, 10));
+    }
+
+    /**
+     * Run a benchmark and report it.
+     *
+     * prepare() is called before every repetition, outside of the measurement. run() is what
+     * gets measured. bytes is the number of bytes on the wire of a single frame.
+     */
+    template< typename Prepare, typename Run>
+    void bench( const char *name, uint16_t bytes, Prepare prepare, Run run)
+    {
+        uint32_t cycles = 0;
+        bool overflow = false;
+        for (uint8_t count = 0; count < repetitions; ++count)
+        {
+            prepare();
+            cycle_counter::start();
+            run();
+            const uint16_t measured = cycle_counter::stop();
+            overflow = overflow or measured == 0xffff;
+            cycles += measured - overhead;
+        }
+
+        put_P( overflow ? PSTR( "@error ") : PSTR( "@bench "));
+        put_P( name);
+        put_number( repetitions);
+        put_number( static_cast<uint32_t>( bytes) * repetitions);
+        put_number( cycles);
+        put( '\n');
+    }
+
+    template< typename Run>
+    void bench_encode( const char *name, Run run)
+    {
+        // the number of bytes that one frame takes, from a run that is not measured.
+        transport.clear();
+        run();
+        const uint16_t bytes = transport.sent();
+
+        bench( name, bytes, []{ transport.clear();}, run);
+    }
+
+    /// SLIP-encoded frames as the esp-link would send them.
+    uint8_t frame[128];
+    uint8_t frame_size = 0;
+
+    void put_frame_byte( uint8_t value)
+    {
+        if (value == esp_link::detail::SLIP_END)
+        {
+            frame[frame_size++] = esp_link::detail::SLIP_ESC;
+            value = esp_link::detail::SLIP_ESC_END;
+        }
+        else if (value == esp_link::detail::SLIP_ESC)
+        {
+            frame[frame_size++] = esp_link::detail::SLIP_ESC;
+            value = esp_link::detail::SLIP_ESC_ESC;
+        }
+        frame[frame_size++] = value;
+    }
+
+    void put_frame_data( const uint8_t *data, uint8_t size, uint16_t &crc)
+    {
+        while (size--)
+        {
+            crc = esp_link::crc16::update( crc, *data);
+            put_frame_byte( *data++);
+        }
+    }
+
+    /// Build a frame with the given header and up to two string arguments in 'frame'.
+    void build_frame( uint16_t cmd, uint32_t value, const char *first = nullptr, const char *second = nullptr)
+    {
+        const char *arguments[] = { first, second};
+        esp_link::packet header{};
+        header.cmd = cmd;
+        header.argc = (first ? 1 : 0) + (second ? 1 : 0);
+        header.value = value;
+
+        uint16_t crc = 0;
+        frame_size = 0;
+        frame[frame_size++] = esp_link::detail::SLIP_END;
+        put_frame_data( reinterpret_cast<const uint8_t *>( &header), sizeof header, crc);
+        for (uint8_t index = 0; index < header.argc; ++index)
+        {
+            const uint16_t length = strlen( arguments[index]);
+            const uint8_t padding[3] = {};
+            put_frame_data( reinterpret_cast<const uint8_t *>( &length), sizeof length, crc);
+            put_frame_data( reinterpret_cast<const uint8_t *>( arguments[index]), length, crc);
+            put_frame_data( padding, (4 - (length & 3)) & 3, crc);
+        }
+        put_frame_byte( crc);
+        put_frame_byte( crc >> 8);
+        frame[frame_size++] = esp_link::detail::SLIP_END;
+    }
+
+    /// Use the bytes that the client sent as a frame. The client does not care what command
+    /// a packet holds, as long as it is neither a sync nor a callback.
+    template< typename Encode>
+    void capture_frame( Encode encode)
+    {
+        transport.clear();
+        encode();
+        frame_size = transport.sent();
+        memcpy( frame, transport.output(), frame_size);
+    }
+
+    void bench_decode( const char *name)
+    {
+        bench( name, frame_size,
+                []{ transport.feed( frame, frame_size);},
+                []{
+                    while (transport.data_available()) esp.release( esp.try_receive());
+                });
+    }
+
+    const char payload_4[]   = "21.5";
+    const char payload_32[]  = "{\"pir\":0,\"led\":1,\"uptime\":12345}";
+    const char payload_64[]  = "{\"pir\":0,\"led\":1,\"uptime\":123456,\"rssi\":-67,\"heap\":12345,\"v\":3}";
+
+    volatile uint8_t callbacks_called = 0;
+}
+
+int main()
+{
+    using esp_link::mqtt::publish;
+    using esp_link::mqtt::subscribe;
+
+    uart_init();
+    cycle_counter::init();
+    cycle_counter::start();
+    overhead = cycle_counter::stop();
+
+#if defined( BENCH_ENCODE)
+    bench_encode( PSTR( "encode_subscribe"),         []{ esp.execute( subscribe, "/spider/LED", 0);});
+    bench_encode( PSTR( "encode_subscribe_flash"),   []{ esp.execute( subscribe, F_( "/spider/LED"), 0);});
+    bench_encode( PSTR( "encode_subscribe_frame"),   []{ esp.send_frame(
+            esp_link::make_frame( subscribe, ESP_LINK_STRING( "/spider/LED"), esp_link::constant<0>{}));});
+    bench_encode( PSTR( "encode_publish_4"),         []{ esp.execute( publish, "/spider/temp", payload_4, 0, 0);});
+    bench_encode( PSTR( "encode_publish_32"),        []{ esp.execute( publish, "/spider/temp", payload_32, 0, 0);});
+    bench_encode( PSTR( "encode_publish_64"),        []{ esp.execute( publish, "/spider/temp", payload_64, 0, 0);});
+    bench_encode( PSTR( "encode_publish_flash_32"),  []{ esp.execute( publish, F_( "/spider/temp"),
+            F_( "{\"pir\":0,\"led\":1,\"uptime\":12345}"), 0, 0);});
+#elif defined( BENCH_DECODE)
+    capture_frame( []{ esp.execute( subscribe, "/spider/LED", 0);});
+    bench_decode( PSTR( "decode_subscribe"));
+    capture_frame( []{ esp.execute( publish, "/spider/temp", payload_4, 0, 0);});
+    bench_decode( PSTR( "decode_publish_4"));
+    capture_frame( []{ esp.execute( publish, "/spider/temp", payload_32, 0, 0);});
+    bench_decode( PSTR( "decode_publish_32"));
+    capture_frame( []{ esp.execute( publish, "/spider/temp", payload_64, 0, 0);});
+    bench_decode( PSTR( "decode_publish_64"));
+#elif defined( BENCH_CALLBACK)
+    const uint32_t handle = esp.register_callback( []( const esp_link::packet *){ ++callbacks_called;});
+    build_frame( esp_link::commands::CMD_RESP_CB, handle, "/spider/LED", "1");
+    bench_decode( PSTR( "callback_dispatch"));
+    build_frame( esp_link::commands::CMD_RESP_CB, handle, "/spider/status", payload_32);
+    bench_decode( PSTR( "callback_dispatch_32"));
+    build_frame( esp_link::commands::CMD_RESP_CB, handle + 1, "/spider/LED", "1");
+    bench_decode( PSTR( "callback_unknown"));
+#else
+#error "define one of BENCH_ENCODE, BENCH_DECODE or BENCH_CALLBACK"
+#endif
+
+    // simavr ends the simulation when the CPU sleeps with interrupts disabled.
+    while (!(UCSR0A & _BV( TXC0))) {}
+    cli();
+    sleep_enable();
+    sleep_cpu();
+    for (;;) {}
+}
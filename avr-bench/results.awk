@@ -0,0 +1,40 @@
+#
+#  Copyright (C) 2017 Danny Havenith
+#
+#  Distributed under the Boost Software License, Version 1.0. (See
+#  accompanying file LICENSE_1_0.txt or copy at
+#  http://www.boost.org/LICENSE_1_0.txt)
+#
+# Turn the output of the benchmark firmware, or with -v footprint=1 the output of avr-size,
+# into rows of the results table.
+#
+# simavr may decorate the uart output, so the result lines are searched for their marker
+# instead of being expected at the start of a line.
+#
+
+footprint && $1 ~ /^[0-9]+$/ {
+    image = $6
+    sub( /.*\//, "", image)
+    sub( /\.elf$/, "", image)
+    # flash holds code and initialized data, RAM holds initialized and zero-initialized data.
+    printf "%s\t%d\t%d\n", image, $1 + $2, $2 + $3
+    next
+}
+
+!footprint {
+    position = index( $0, "@bench ")
+    if (!position) position = index( $0, "@error ")
+    if (!position) next
+
+    marker = substr( $0, position, 6)
+    split( substr( $0, position + 7), field, " ")
+    frames = field[2] + 0
+    bytes  = field[3] + 0
+    cycles = field[4] + 0
+    if (marker == "@error") {
+        printf "%s\toverflow\n", field[1]
+        next
+    }
+    printf "%s\t%d\t%d\t%d\t%.1f\t%.2f\n", field[1], frames, bytes, cycles,
+           frames ? cycles / frames : 0, bytes ? cycles / bytes : 0
+}
@@ -0,0 +1,168 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef CAPTURE_CAPTURE_HPP_
+#define CAPTURE_CAPTURE_HPP_
+
+/**
+ * Capture of the raw bytes on a serial line.
+ *
+ * capturing_transport sits between a client and its uart and hands every byte that
+ * passes, in either direction, to a recorder. On the device the recorder is a ring of
+ * the most recent bytes in RAM (capture::ring), in the host build it can be a file
+ * (@see host/capture_file.hpp), which can be replayed later.
+ *
+ * @code{.cpp}
+ * serial::uart<> uart;
+ * capture::ring<64> recent_bytes;
+ * capture::capturing_transport<serial::uart<>, capture::ring<64>> captured_uart( uart, recent_bytes);
+ * esp_link::basic_client<decltype( captured_uart)> esp( captured_uart);
+ * @endcode
+ *
+ * Bytes that the client sends through its transmit queue (ESP_LINK_TX_BUFFER_SIZE > 0) go
+ * from the interrupt handler directly to the USART and are not captured.
+ */
+#include "timing/clock.hpp"
+#include <stdint.h>
+#ifndef __AVR__
+#include <stdio.h>
+#endif
+
+namespace capture
+{
+    enum class direction : uint8_t
+    {
+        rx, ///< received from the uart
+        tx  ///< sent to the uart
+    };
+
+    struct sample
+    {
+        uint16_t    delay;  ///< microseconds since the previous sample, at most 0xffff
+        uint8_t     value;
+        direction   dir;
+    };
+
+    /**
+     * Recorder that keeps the last Size bytes in RAM.
+     *
+     * Time is stored as the delay since the previous byte, which keeps a sample at 4 bytes.
+     * Longer pauses than 65ms are recorded as 65ms, which does not change the way a
+     * capture decodes.
+     */
+    template< uint8_t Size>
+    class ring
+    {
+    public:
+        static_assert( Size > 0 and Size <= 128 and (Size & (Size - 1)) == 0,
+                "Size of a capture ring must be a power of two, at most 128");
+
+        void record( direction dir, uint8_t value)
+        {
+            const uint32_t now = timing::clock::now_us();
+            const uint32_t delay = m_used ? now - m_last_us : 0;
+            m_last_us = now;
+
+            m_samples[m_next] = sample{ static_cast<uint16_t>( delay > 0xffff ? 0xffff : delay), value, dir};
+            m_next = (m_next + 1) & (Size - 1);
+            if (m_used < Size) ++m_used;
+        }
+
+        /// Number of samples in the ring.
+        uint8_t size() const
+        {
+            return m_used;
+        }
+
+        /// Return the sample at position index, where index 0 is the oldest sample in the ring.
+        const sample &at( uint8_t index) const
+        {
+            return m_samples[(m_next - m_used + index) & (Size - 1)];
+        }
+
+        void clear()
+        {
+            m_used = 0;
+        }
+
+#ifndef __AVR__
+        /// Print the samples in the text format of capture files, oldest sample first.
+        void print( FILE *output = stdout) const
+        {
+            uint32_t time = 0;
+            for (uint8_t index = 0; index < size(); ++index)
+            {
+                const sample &s = at( index);
+                time += s.delay;
+                fprintf( output, "%u %s %02x\n", time, s.dir == direction::rx ? "rx" : "tx", s.value);
+            }
+        }
+#endif
+
+    private:
+        sample      m_samples[Size];
+        uint32_t    m_last_us = 0;
+        uint8_t     m_next = 0;
+        uint8_t     m_used = 0;
+    };
+
+    /**
+     * Transport that forwards to another transport and records every byte that passes.
+     *
+     * Recorder must provide record( direction, uint8_t).
+     */
+    template< typename Transport, typename Recorder>
+    class capturing_transport
+    {
+    public:
+        capturing_transport( Transport &transport, Recorder &recorder)
+        : m_transport{ &transport}, m_recorder{ &recorder}
+        {
+        }
+
+        void send( uint8_t value)
+        {
+            m_recorder->record( direction::tx, value);
+            m_transport->send( value);
+        }
+
+        void send( const char *string)
+        {
+            while (*string) send( static_cast<uint8_t>( *string++));
+        }
+
+        bool data_available()
+        {
+            return m_transport->data_available();
+        }
+
+        uint8_t read()
+        {
+            const uint8_t value = m_transport->read();
+            m_recorder->record( direction::rx, value);
+            return value;
+        }
+
+        uint8_t get()
+        {
+            const uint8_t value = m_transport->get();
+            m_recorder->record( direction::rx, value);
+            return value;
+        }
+
+        Transport &transport()
+        {
+            return *m_transport;
+        }
+
+    private:
+        Transport   *m_transport;
+        Recorder    *m_recorder;
+    };
+}
+
+#endif /* CAPTURE_CAPTURE_HPP_ */
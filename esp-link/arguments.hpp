@@ -0,0 +1,206 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_ARGUMENTS_HPP_
+#define ESP_LINK_ARGUMENTS_HPP_
+#include "packet.hpp"
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * A single argument of a received packet.
+     *
+     * This refers to the bytes inside the packet, nothing is copied. Note that string
+     * arguments are not zero-terminated.
+     */
+    struct argument
+    {
+        const uint8_t   *data = nullptr;
+        uint16_t        size = 0;
+
+        explicit operator bool() const
+        {
+            return data != nullptr;
+        }
+
+        const char *chars() const
+        {
+            return reinterpret_cast<const char *>( data);
+        }
+
+        /**
+         * Read an integer value from this argument.
+         *
+         * Values are stored little-endian and, inside a packet, without any alignment.
+         * This returns false and leaves the value untouched if the argument does not
+         * have exactly the size of T.
+         */
+        template< typename T>
+        bool get( T &value) const
+        {
+            if (!data or size != sizeof value) return false;
+
+            T result = 0;
+            for (uint8_t index = sizeof value; index; --index)
+            {
+                result = (result << 8) | data[index - 1];
+            }
+            value = result;
+            return true;
+        }
+
+        /// Return the integer value of this argument, or 'otherwise' if it does not hold a T.
+        template< typename T>
+        T as( T otherwise = T{}) const
+        {
+            get( otherwise);
+            return otherwise;
+        }
+    };
+
+    /**
+     * View of the arguments of a received packet.
+     *
+     * Arguments are stored in the packet as a 16-bit length, followed by that many bytes,
+     * padded with zeros to a multiple of 4 bytes. This view walks that list, without
+     * ever reading beyond the end of the packet. Arguments that do not fit
+     * in the packet are simply not there, which can be detected with complete().
+     *
+     * @code{.cpp}
+     * for (const auto &arg : esp.arguments( p))
+     * {
+     *     ...arg.data, arg.size...
+     * }
+     * @endcode
+     */
+    class argument_list
+    {
+    public:
+        class iterator
+        {
+        public:
+            iterator( const uint8_t *position, const uint8_t *end, uint16_t remaining)
+            : m_position{ position}, m_end{ end}, m_remaining{ remaining}
+            {
+                parse();
+            }
+
+            const argument &operator*() const
+            {
+                return m_current;
+            }
+
+            const argument *operator->() const
+            {
+                return &m_current;
+            }
+
+            iterator &operator++()
+            {
+                const uint16_t padded = (m_current.size + 3) & ~3;
+                const uint16_t available = m_end - m_current.data;
+                m_position = m_current.data + (padded < available ? padded : available);
+                --m_remaining;
+                parse();
+                return *this;
+            }
+
+            bool operator==( const iterator &other) const
+            {
+                return m_remaining == other.m_remaining;
+            }
+
+            bool operator!=( const iterator &other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            /// read the argument at the current position, or become the end iterator
+            /// if there is none.
+            void parse()
+            {
+                m_current = argument{};
+                if (!m_remaining) return;
+
+                if (m_end - m_position < 2)
+                {
+                    m_remaining = 0;
+                    return;
+                }
+
+                const uint16_t size = m_position[0] | (m_position[1] << 8);
+                if (m_end - m_position - 2 < size)
+                {
+                    m_remaining = 0;
+                    return;
+                }
+
+                m_current.data = m_position + 2;
+                m_current.size = size;
+            }
+
+            const uint8_t   *m_position;
+            const uint8_t   *m_end;
+            uint16_t        m_remaining;
+            argument        m_current;
+        };
+
+        /**
+         * Create a view of the arguments of packet p.
+         *
+         * size is the number of bytes that were received for the packet, including
+         * the header, but without the crc.
+         */
+        argument_list( const packet *p, uint16_t size)
+        : m_packet{ p},
+          m_end{ p ? p->args + (size > sizeof( packet) ? size - sizeof( packet) : 0) : nullptr}
+        {
+        }
+
+        iterator begin() const
+        {
+            return { m_packet ? m_packet->args : nullptr, m_end, m_packet ? m_packet->argc : uint16_t{}};
+        }
+
+        iterator end() const
+        {
+            return { m_end, m_end, 0};
+        }
+
+        /// Number of arguments that are actually present in the packet.
+        uint16_t size() const
+        {
+            uint16_t count = 0;
+            for (auto it = begin(); it != end(); ++it) ++count;
+            return count;
+        }
+
+        /// Return whether all arguments that the packet header announces are present.
+        bool complete() const
+        {
+            return m_packet and size() == m_packet->argc;
+        }
+
+        /// Return the argument at position index, or an empty argument if there is no such argument.
+        argument operator[]( uint16_t index) const
+        {
+            for (auto it = begin(); it != end(); ++it)
+            {
+                if (!index--) return *it;
+            }
+            return {};
+        }
+
+    private:
+        const packet    *m_packet;
+        const uint8_t   *m_end;
+    };
+}
+
+#endif /* ESP_LINK_ARGUMENTS_HPP_ */
@@ -0,0 +1,161 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_CALLBACK_REGISTRY_HPP_
+#define ESP_LINK_CALLBACK_REGISTRY_HPP_
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * Table of callbacks that were handed to the esp-link.
+     *
+     * The esp-link never sees a function address, instead it receives a 32-bit handle, which it
+     * sends back in the value field of a callback packet. A handle consists of the
+     * position in the table (lowest byte) and the 16-bit generation of that position (next two bytes).
+     * The generation changes every time a callback is removed from its position and every time
+     * the registry is cleared, so that handles of removed callbacks do not match the callback
+     * that replaces them. There are 65535 generations: a handle that is that many generations
+     * old matches its position again.
+     *
+     * Free positions are kept in a linked list, which makes both add() and remove()
+     * constant-time operations.
+     *
+     * A valid handle is never zero.
+     */
+    template< uint8_t Capacity, typename Callback>
+    class callback_registry
+    {
+    public:
+        static_assert( Capacity > 0 and Capacity < 0xff, "Capacity of a callback registry must be between 1 and 254");
+
+        static constexpr uint32_t invalid_handle = 0;
+
+        callback_registry()
+        {
+            clear();
+        }
+
+        /**
+         * Add a callback to the registry and return its handle.
+         *
+         * Returns invalid_handle if the callback is empty or if the registry is full.
+         */
+        uint32_t add( const Callback &callback)
+        {
+            if (!callback or m_free == end) return invalid_handle;
+
+            const uint8_t index = m_free;
+            m_free = m_next[index];
+            m_next[index] = used;
+            m_callbacks[index] = callback;
+
+            return handle( index);
+        }
+
+        /**
+         * Remove the callback with the given handle.
+         *
+         * Returns false if the handle does not refer to a registered callback.
+         */
+        bool remove( uint32_t handle)
+        {
+            const uint8_t index = lookup( handle);
+            if (index == end) return false;
+
+            release( index);
+            return true;
+        }
+
+        /**
+         * Find the callback with the given handle.
+         *
+         * Returns nullptr if the handle was never handed out, or if the callback
+         * has been removed since.
+         */
+        const Callback *find( uint32_t handle) const
+        {
+            const uint8_t index = lookup( handle);
+            return index == end ? nullptr : &m_callbacks[index];
+        }
+
+        /**
+         * Remove all callbacks.
+         *
+         * This invalidates all handles that were handed out before.
+         */
+        void clear()
+        {
+            for (uint8_t index = 0; index < Capacity; ++index)
+            {
+                if (m_next[index] == used) m_callbacks[index] = Callback{};
+                next_generation( index);
+                m_next[index] = index + 1 < Capacity ? index + 1 : end;
+            }
+            m_free = 0;
+        }
+
+        /// Number of registered callbacks.
+        uint8_t size() const
+        {
+            uint8_t count = 0;
+            for (uint8_t index = 0; index < Capacity; ++index)
+            {
+                if (m_next[index] == used) ++count;
+            }
+            return count;
+        }
+
+        static constexpr uint8_t capacity()
+        {
+            return Capacity;
+        }
+
+    private:
+        static constexpr uint8_t end  = 0xff; ///< end of the free list
+        static constexpr uint8_t used = 0xfe; ///< marks a position that is not in the free list
+
+        uint32_t handle( uint8_t index) const
+        {
+            return static_cast<uint32_t>( m_generations[index]) << 8 | index;
+        }
+
+        /// return the position that a handle refers to, or 'end' if the handle is not valid.
+        uint8_t lookup( uint32_t handle) const
+        {
+            const uint8_t index = handle & 0xff;
+            if (index >= Capacity
+                    or m_next[index] != used
+                    or (handle >> 8) != m_generations[index])
+            {
+                return end;
+            }
+            return index;
+        }
+
+        void release( uint8_t index)
+        {
+            m_callbacks[index] = Callback{};
+            next_generation( index);
+            m_next[index] = m_free;
+            m_free = index;
+        }
+
+        /// generations skip zero, so that no handle is ever zero.
+        void next_generation( uint8_t index)
+        {
+            if (!++m_generations[index]) ++m_generations[index];
+        }
+
+        Callback    m_callbacks[Capacity];
+        uint8_t     m_next[Capacity] = {};        ///< next free position, or 'used'
+        uint16_t    m_generations[Capacity] = {};
+        uint8_t     m_free = end;
+    };
+}
+
+#endif /* ESP_LINK_CALLBACK_REGISTRY_HPP_ */
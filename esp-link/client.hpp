@@ -7,37 +7,125 @@
 //
 #ifndef ESP_LINK_CLIENT_HPP_
 #define ESP_LINK_CLIENT_HPP_
+#include "arguments.hpp"
+#include "callback_registry.hpp"
 #include "command.hpp"
+#include "command_codes.hpp"
+#include "crc16.hpp"
+#include "frame.hpp"
+#include "packet.hpp"
+#include "packet_pool.hpp"
+#include "payload.hpp"
+#include "pending_requests.hpp"
+#include "ring_buffer.hpp"
+#include "span.hpp"
+#include "statistics.hpp"
+#include "stream_receiver.hpp"
+#include "trace.hpp"
+#include "tx_interrupt.hpp"
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <avr_utilities/devices/uart.h>
+#include <avr_utilities/flash_string.hpp>
 
 #include <string.h>
 
 #include "function/function.hpp"
+#include "timing/clock.hpp"
 
+/**
+ * Size of the transmit queue of the client.
+ *
+ * If this is zero, every byte is sent directly to the uart and execute() only
+ * returns when the complete request has been handed to the uart.
+ * Otherwise, execute() puts the request in a transmit queue of this many bytes
+ * (a power of two, at most 128) and returns immediately, while an interrupt handler
+ * drains the queue (@see tx_interrupt.hpp). execute() only waits if the queue is full.
+ */
+#ifndef ESP_LINK_TX_BUFFER_SIZE
+#define ESP_LINK_TX_BUFFER_SIZE 0
+#endif
+
+/**
+ * Number of receive buffers of the client.
+ *
+ * A received packet occupies its buffer until it is released, while
+ * the next packet is received in another buffer.
+ */
+#ifndef ESP_LINK_RX_SLOTS
+#define ESP_LINK_RX_SLOTS 2
+#endif
+
+/**
+ * Maximum number of requests that can wait for a response at the same time.
+ */
+#ifndef ESP_LINK_PENDING_REQUESTS
+#define ESP_LINK_PENDING_REQUESTS 4
+#endif
+
+/**
+ * Maximum number of callbacks that can be registered with the client at the same time.
+ */
+#ifndef ESP_LINK_CALLBACKS
+#define ESP_LINK_CALLBACKS 8
+#endif
+
+/**
+ * Marks the functions that are called for every byte that is sent. These are always inlined,
+ * so that the loops that send parameters end up directly at the transport.
+ */
+#define ESP_LINK_INLINE inline __attribute__((always_inline))
 
-namespace flash_string
-{
-    class helper;
-}
 namespace esp_link
 {
-    struct packet
+    /**
+     * State of the link with the esp-link.
+     */
+    enum class link_state : uint8_t
     {
-        uint16_t cmd;            /**< Command to execute */
-        uint16_t argc;           /**< Number of arguments */
-        uint32_t value;          /**< Callback to invoke, NULL if none; or response value */
-        uint8_t  args[0];        /**< Arguments */
+        down,       ///< not synchronized, and not trying to
+        syncing,    ///< a sync request was sent, waiting for the response
+        backoff,    ///< the last sync failed, waiting before trying again
+        up          ///< synchronized
     };
 
-
-    class client
+    /**
+     * Client for the esp-link serial protocol.
+     *
+     * Transport is the type of the uart that connects to the esp-link. It must provide
+     * send( uint8_t), data_available(), read() and get(), like serial::uart<> does. Because
+     * the client is a template of its transport, the complete path from a byte of a
+     * parameter to the uart can be inlined, and a program can use several clients on different
+     * uarts.
+     *
+     * @see client for the client on the default avr_utilities uart.
+     */
+    template< typename Transport>
+    class basic_client
     {
     public:
+        using transport_type = Transport;
 
         using callback_type = function::function<void (const packet *)>;
-        client( serial::uart<> &uart)
+
+        /**
+         * Callback type that receives the result of a command with return type ReturnType.
+         *
+         * The first argument is true if a response arrived and false if the request failed
+         * or timed out. In the latter case, the second argument is a default-constructed value.
+         */
+        template< typename ReturnType>
+        using completion = function::function<void (bool, typename return_type<ReturnType>::type)>;
+
+        /// Callback type that is stored for a pending request. This is large enough to hold
+        /// a completion<> callback.
+        using request_callback = function::function<void (const packet *), sizeof( completion<uint32_t>)>;
+        using request_table = esp_link::pending_requests<ESP_LINK_PENDING_REQUESTS, request_callback>;
+
+        /// Time in milliseconds after which a request without response fails.
+        static constexpr uint16_t request_timeout_ms = 1000;
+        basic_client( Transport &uart)
         : m_uart{&uart}
         {
         }
@@ -59,30 +147,337 @@ namespace esp_link
             static_assert( sizeof...(Parameters) >= sizeof...(Arguments), "Too many arguments provided for this command");
 
             constexpr uint16_t argc = send_parameter_count( tag<Parameters>{}...);
-            send_request_header( Cmd, 0x142, argc);
+            send_request_header( Cmd, request_id( Cmd, tag<ReturnType>{}), argc);
+            (void)((int[]){0, (add_parameter(tag<Parameters>{}, args),0)...});
+            finalize_request();
+        }
+
+        /**
+         * Execute a command that has a return value and call a completion callback when the response
+         * arrives, or when the request times out.
+         *
+         * Unlike with a blocking receive(), several requests can be in flight at the
+         * same time. The completion callback is called from within try_receive().
+         *
+         * Returns false, without sending anything, if too many requests are already waiting
+         * for a response.
+         */
+        template< uint16_t Cmd, typename ReturnType, typename... Parameters, typename... Arguments>
+        bool execute_async(
+                command<Cmd, ReturnType( Parameters...)> /*ignore*/,
+                completion<ReturnType> on_complete,
+                const Arguments &... args)
+        {
+            static_assert( sizeof...(Parameters) <= sizeof...(Arguments), "Too few arguments provided for this command");
+            static_assert( sizeof...(Parameters) >= sizeof...(Arguments), "Too many arguments provided for this command");
+
+            const uint32_t value = request_value( Cmd);
+            if (!m_requests.add( value, request_deadline(), request_completion<ReturnType>( on_complete), echoes_request_id( Cmd))) return false;
+
+            constexpr uint16_t argc = send_parameter_count( tag<Parameters>{}...);
+            send_request_header( Cmd, value, argc);
             (void)((int[]){0, (add_parameter(tag<Parameters>{}, args),0)...});
             finalize_request();
+            return true;
+        }
+
+        /// Number of requests that are waiting for a response.
+        uint8_t pending_requests() const
+        {
+            return m_requests.size();
+        }
+
+        /**
+         * Send a frame that was computed at compile time.
+         *
+         * This sends exactly the same bytes as execute() would with the same arguments, but
+         * without doing any of the work at runtime.
+         *
+         * @see make_frame()
+         */
+        template< uint8_t... Bytes>
+        void send_frame( frame<Bytes...>)
+        {
+            send_frame_P( frame<Bytes...>::data, frame<Bytes...>::size);
         }
 
-        const packet* receive(uint32_t timeout = 50000L);
+        const packet* receive(uint16_t timeout_ms = 500);
         const packet* try_receive();
+        bool receive_byte(uint8_t& value, uint32_t timeout_us = 125000L);
+
+        /**
+         * Hand a packet that was returned by receive() or try_receive() back to the client.
+         *
+         * Received packets stay valid until they are released, every packet that is
+         * returned must be released eventually, or the client will run out of receive buffers.
+         * Releasing a nullptr is allowed and does nothing.
+         */
+        void release(const packet *p)
+        {
+            if (p) m_packets.release( p);
+        }
+
+        /**
+         * Return a view of the arguments of a packet that was received by this client.
+         *
+         * This can be used for packets returned by receive() or try_receive() and for packets
+         * that are passed to callbacks, as long as they have not been released.
+         */
+        argument_list arguments( const packet *p) const
+        {
+            return { p, m_packets.size_of( p)};
+        }
+
+        /**
+         * Set the handler for frames that are too large for a receive buffer.
+         *
+         * Without a handler (the default) such frames are dropped. The handler
+         * must stay alive as long as it is set.
+         * @see stream_handler
+         */
+        void set_stream_handler( stream_handler *handler)
+        {
+            m_stream.set_handler( handler);
+        }
+
+        /// Counters that describe the behavior of the link, @see publish_statistics().
+        const link_statistics &statistics() const
+        {
+            return m_statistics;
+        }
+
+        void reset_statistics()
+        {
+            m_statistics = link_statistics{};
+        }
 
         void log_packet(const esp_link::packet *p);
 
+        /**
+         * Register a callback and return the handle that represents it for the esp-link.
+         *
+         * Callback arguments of execute() are registered automatically, this is only needed
+         * to obtain a handle for a callback up front. A handle can be passed to execute() in
+         * place of a callback.
+         * Returns 0 if the callback is empty or if there is no room for more callbacks.
+         *
+         * All callbacks are removed when the client synchronizes with the esp-link, because the esp-link
+         * does not remember them after a sync.
+         */
+        uint32_t register_callback(callback_type f)
+        {
+            return m_callbacks.add( f);
+        }
+
+        /**
+         * Register a callback with the esp-link under a name, e.g. "wifiCb", which the esp-link calls
+         * for every change of the wifi status.
+         *
+         * CMD_CB_ADD carries the callback in the value of the request header instead of in an
+         * argument, which is why there is no command<> definition for it.
+         * Returns the handle of the callback, or 0 if it could not be registered.
+         */
+        template< typename Name>
+        uint32_t add_named_callback( const Name &name, callback_type f)
+        {
+            const uint32_t handle = register_callback( f);
+            if (handle)
+            {
+                send_request_header( commands::CMD_CB_ADD, handle, 1);
+                add_parameter( tag<string>{}, name);
+                finalize_request();
+            }
+            return handle;
+        }
+
+        /**
+         * Remove a registered callback.
+         *
+         * Callback packets for the handle that arrive afterwards are ignored.
+         * Returns false if the handle did not refer to a registered callback.
+         */
+        bool unregister_callback( uint32_t handle)
+        {
+            return m_callbacks.remove( handle);
+        }
+
+
+        /// Function that is called when the link comes up, @see on_link_up().
+        using link_up_handler = function::function<void ()>;
+
+        /// Time in milliseconds to wait before retrying after the first failed sync. This doubles
+        /// with every consecutive failure, up to sync_retry_max_ms.
+        static constexpr uint16_t sync_retry_min_ms = 250;
+        static constexpr uint16_t sync_retry_max_ms = 16000;
+
+        /**
+         * Start to synchronize with the esp-link and return immediately.
+         *
+         * The synchronization is driven by try_receive(): when the esp-link responds, the link
+         * is up and the link-up handler is called. If it does not respond in time,
+         * the client retries with exponential backoff, until it succeeds. The same happens
+         * when the esp-link announces that it restarted.
+         */
+        void connect();
+
+        /// Current state of the link with the esp-link.
+        link_state state() const
+        {
+            return m_link_state;
+        }
+
+        /**
+         * Set the function that is called every time the link comes up, either for the first time
+         * or after the esp-link restarted. Because the esp-link forgets everything
+         * at a restart, this is the place to set up callbacks and subscribe to topics.
+         */
+        void on_link_up( link_up_handler handler)
+        {
+            m_on_link_up = handler;
+        }
 
         void send(const char* str);
         bool sync();
-            void send_padding(uint16_t length);
+        void send_padding(uint16_t length);
+
+        /**
+         * Return whether the given number of bytes can be sent without waiting.
+         *
+         * Note that bytes are counted as they appear on the wire, after SLIP escaping.
+         * Without a transmit queue this is always true, because sending is then
+         * always a blocking operation.
+         */
+        bool can_send( uint16_t bytes) const
+        {
+#if ESP_LINK_TX_BUFFER_SIZE
+            return bytes <= m_tx_queue.space();
+#else
+            (void)bytes;
+            return true;
+#endif
+        }
+
+        /// Number of bytes in the transmit queue that have not been sent yet.
+        uint8_t tx_queue_depth() const
+        {
+#if ESP_LINK_TX_BUFFER_SIZE
+            return m_tx_queue.size();
+#else
+            return 0;
+#endif
+        }
+
+        /**
+         * Take the next byte from the transmit queue.
+         *
+         * This is called by the transmit interrupt handler (or by host code that plays its role).
+         * Returns false if there is nothing to send.
+         */
+        bool next_tx_byte( uint8_t &value)
+        {
+#if ESP_LINK_TX_BUFFER_SIZE
+            return m_tx_queue.pop( value);
+#else
+            (void)value;
+            return false;
+#endif
+        }
 
     private:
 
         template <typename T>
         struct tag {};
 
+        // metafunction to exclude arguments from parameter type deduction
+        template<typename T>
+        struct literally
+        {
+            using type = T;
+        };
+
+        template<typename T>
+        using literally_t = typename literally<T>::type;
+
+        /// conversion of a response packet to the return type of a command
+        template< typename ReturnType>
+        static typename return_type<ReturnType>::type response_value( tag<ReturnType>, const packet *p)
+        {
+            return static_cast<typename return_type<ReturnType>::type>( p->value);
+        }
+
+        static bool response_value( tag<ack>, const packet *)
+        {
+            return true;
+        }
+
+        /// wrap a typed completion callback into a callback for the pending request table.
+        template< typename ReturnType>
+        static request_callback request_completion( completion<ReturnType> f)
+        {
+            return [f]( const packet *response) mutable
+                {
+                    if (response)
+                    {
+                        f( true, response_value( tag<ReturnType>{}, response));
+                    }
+                    else
+                    {
+                        f( false, typename return_type<ReturnType>::type{});
+                    }
+                };
+        }
+
+        uint32_t next_request_id()
+        {
+            if (!++m_last_request_id) ++m_last_request_id;
+            return m_last_request_id;
+        }
+
+        // Determine the value to send in the request header. Commands without a
+        // return value get no id. Other commands get an entry in the pending request table,
+        // even if nobody waits for the result, to keep the responses to other
+        // requests in the right order.
+        static constexpr uint32_t request_id( uint16_t, tag<void>)
+        {
+            return 0;
+        }
+
+        template< typename ReturnType>
+        uint32_t request_id( uint16_t cmd, tag<ReturnType>)
+        {
+            const uint32_t value = request_value( cmd);
+            const request_callback ignore;
+            if (!m_requests.add( value, request_deadline(), ignore, echoes_request_id( cmd)))
+            {
+                m_requests.expire_oldest();
+                m_requests.add( value, request_deadline(), ignore, echoes_request_id( cmd));
+            }
+            return value;
+        }
+
+        /// The value to send in the header of a new request for the given command.
+        uint32_t request_value( uint16_t cmd)
+        {
+            const uint32_t id = next_request_id();
+            return echoes_request_id( cmd) ? request_table::echo_value( id) : id;
+        }
+
+        /// Whether the esp-link answers a command with the value of the request, instead of
+        /// with a value of its own.
+        static constexpr bool echoes_request_id( uint16_t cmd)
+        {
+            return cmd == commands::CMD_SYNC;
+        }
+
+        static uint32_t request_deadline()
+        {
+            return timing::clock::now_ms() + request_timeout_ms;
+        }
+
         // constexpr functions to determine how many parameters to send to the
         // esp-link, given the list of function parameters.
         // This is not simply the count of the function parameters, because parameters
-        // of type 'string_with_extra_len' are represented as a single argument, but will
+        // of type 'string_with_extra_len' or 'binary_with_extra_len' are represented as a single argument, but will
         // result in two parameters being sent to the esp-link.
         template< typename T>
         static constexpr uint16_t send_parameter_count( tag<T>)
@@ -95,6 +490,11 @@ namespace esp_link
             return 2;
         }
 
+        static constexpr uint16_t send_parameter_count( tag<binary_with_extra_len>)
+        {
+            return 2;
+        }
+
         template< typename Head, typename... Tail>
         static constexpr uint16_t send_parameter_count( tag<Head> head, Tail... tail)
         {
@@ -106,23 +506,21 @@ namespace esp_link
             return 0;
         }
 
-        // metafunction to exclude arguments from parameter type deduction
-        template<typename T>
-        struct literally
-        {
-            using type = T;
-        };
-
-        template<typename T>
-        using literally_t = typename literally<T>::type;
-
 
         // sending parameters...
         void add_parameter_bytes(const uint8_t* data, uint16_t length);
+        void add_parameter_bytes_P(const uint8_t* data, uint16_t length);
         void add_parameter(tag<callback>,   callback_type f);
+        void add_parameter(tag<callback>,   uint32_t handle);
         void add_parameter(tag<string>,     const char* string);
         void add_parameter(tag<string>,     const flash_string::helper* string);
         void add_parameter(tag<string_with_extra_len>, const char* string);
+        void add_parameter(tag<string_with_extra_len>, const flash_string::helper* string);
+        void add_parameter(tag<string_with_extra_len>, payload bytes);
+        void add_parameter(tag<binary>,     span bytes);
+        void add_parameter(tag<binary>,     span_P bytes);
+        void add_parameter(tag<binary_with_extra_len>, span bytes);
+        void add_parameter(tag<binary_with_extra_len>, span_P bytes);
 
         // send a parameter of any type T, represented by a value that can be converted
         // to type T.
@@ -142,11 +540,10 @@ namespace esp_link
         }
 
 
-        uint32_t register_callback(callback_type f);
-
-        void send_direct(uint8_t value);
-        void send_byte(uint8_t value);
-        void send_bytes(const uint8_t* buffer, uint8_t size);
+        void send_frame_P(const uint8_t* frame, uint16_t size);
+        ESP_LINK_INLINE void send_direct(uint8_t value);
+        ESP_LINK_INLINE void send_byte(uint8_t value);
+        void send_bytes(const uint8_t* buffer, uint16_t size);
         /// sent a value as a sequence of bytes to the esp. This will send
         /// the memory bytes of this value
         template< typename T>
@@ -160,27 +557,774 @@ namespace esp_link
         void finalize_request();
 
         void clear_input();
+        void start_sync();
+        void sync_done( bool ok);
 
-        bool receive_byte(uint8_t& value, uint32_t timeout = 100000L);
+        bool wait_for_byte(uint32_t start_us, uint32_t timeout_us);
         uint8_t receive_byte_w();
 
-        static void crc16_add(uint8_t value, uint16_t &accumulator);
+        ESP_LINK_INLINE static void crc16_add(uint8_t value, uint16_t &accumulator);
 
         const packet* decode_packet(const uint8_t* buffer, uint8_t size);
         const packet* check_packet(const uint8_t* buffer, uint8_t size);
 
         uint16_t        m_runningCrc = 0;
-        serial::uart<>  *m_uart;
+        uint16_t        m_receiveCrc = 0; ///< crc of the frame being received, minus the last two bytes
+        Transport       *m_uart;
         static constexpr uint8_t buffer_size = 128;
-        uint8_t m_buffer[buffer_size];
+        packet_pool<ESP_LINK_RX_SLOTS, buffer_size> m_packets;
+        uint8_t *m_buffer = nullptr; ///< slot that is currently being received in, if any
         uint8_t m_buffer_index = 0;
         bool    m_last_was_esc = false;
-        bool    m_syncing = false;
+        bool    m_overflow = false;  ///< current frame did not fit, or there was no slot for it
+        link_state      m_link_state = link_state::down;
+        uint16_t        m_retry_delay = sync_retry_min_ms;
+        uint32_t        m_retry_at = 0;     ///< time (ms) of the next sync attempt, when in backoff
+        link_up_handler m_on_link_up;
+        stream_receiver m_stream;
+
+        callback_registry<ESP_LINK_CALLBACKS, callback_type> m_callbacks;
+
+        uint32_t        m_last_request_id = 0;
+        request_table   m_requests;
+        link_statistics m_statistics;
 
-        static constexpr uint8_t callbacks_size = 8;
-        callback_type m_callbacks[callbacks_size];
+#if ESP_LINK_TX_BUFFER_SIZE
+        ring_buffer<ESP_LINK_TX_BUFFER_SIZE> m_tx_queue;
+#endif
     };
 
+
+
+    /**
+     * Wait a limited time for a packet to arrive and return
+     * either nullptr if no packet arrived or a pointer to a
+     * successfully received packet
+     *
+     * timeout is specified in milliseconds.
+     *
+     */
+    template< typename Transport>
+    const esp_link::packet* basic_client<Transport>::receive(uint16_t timeout_ms)
+    {
+        // measured in microseconds, so that the timeout does not end up to a millisecond early.
+        const uint32_t start = timing::clock::now_us();
+        do
+        {
+            auto p = try_receive();
+            if (p) return p;
+        }
+        while (timing::clock::now_us() - start < timeout_ms * 1000UL);
+
+        return nullptr;
+    }
+
+    /**
+     * Listen for incoming packets and return immediately if no
+     * packet is arriving.
+     *
+     * Bytes are received in a slot from the packet pool. A packet that
+     * is returned keeps its slot until it is released, all other frames (invalid frames,
+     * callbacks, syncs) free their slot immediately.
+     *
+     * Frames for which no free slot is available are dropped. Frames that do not fit in a slot
+     * are handed to the stream handler, if there is one, and dropped otherwise.
+     */
+    template< typename Transport>
+    const packet* basic_client<Transport>::try_receive()
+    {
+        if (m_requests.size())
+        {
+            m_requests.expire( timing::clock::now_ms());
+        }
+
+        if (m_link_state == link_state::backoff
+                and static_cast<int32_t>( timing::clock::now_ms() - m_retry_at) >= 0)
+        {
+            start_sync();
+        }
+
+        while (m_uart->data_available())
+        {
+            uint8_t lastByte = m_uart->read();
+            ++m_statistics.bytes_received;
+            if (lastByte == detail::SLIP_ESC)
+            {
+                m_last_was_esc = true;
+                continue;
+            }
+
+            if (lastByte == detail::SLIP_END)
+            {
+                const packet *packet = nullptr;
+                if (m_stream.active())
+                {
+                    if (m_stream.finish())
+                    {
+                        ++m_statistics.packets_received;
+                    }
+                    else
+                    {
+                        ++m_statistics.crc_errors;
+                    }
+                    m_packets.release( m_buffer);
+                    m_buffer = nullptr;
+                }
+                else if (m_buffer and not m_overflow)
+                {
+                    // detach the slot before decoding, so that callbacks
+                    // can safely receive packets themselves.
+                    uint8_t *buffer = m_buffer;
+                    m_buffer = nullptr;
+                    packet = decode_packet( buffer, m_buffer_index);
+                    if (not packet) m_packets.release( buffer);
+                }
+                else if (m_overflow)
+                {
+                    ++m_statistics.dropped_frames;
+                    TRACE_ERROR( trace_events::frame_dropped, 0);
+                }
+                m_buffer_index = 0;
+                m_last_was_esc = false;
+                m_overflow = false;
+                if (packet) return packet;
+                continue;
+            }
+
+            if (m_last_was_esc)
+            {
+                m_last_was_esc = false;
+                if (lastByte == detail::SLIP_ESC_ESC)
+                {
+                    lastByte = detail::SLIP_ESC;
+                }
+                else if (lastByte == detail::SLIP_ESC_END)
+                {
+                    lastByte = detail::SLIP_END;
+                }
+            }
+
+            if (m_stream.active())
+            {
+                m_stream.add( lastByte);
+                continue;
+            }
+
+            // rest of a frame that is being dropped.
+            if (m_overflow) continue;
+
+            // a slot is only acquired for the first byte of a frame. If there is none, the
+            // whole frame is dropped, even if a slot is released while it arrives.
+            if (not m_buffer)
+            {
+                m_buffer = m_packets.acquire();
+                if (not m_buffer)
+                {
+                    m_overflow = true;
+                    continue;
+                }
+            }
+
+            if (m_buffer_index < buffer_size)
+            {
+                // maintain the crc while receiving. The last two bytes of a frame are
+                // the crc itself, so the byte that is added is always two
+                // positions behind the one being stored.
+                if (m_buffer_index >= 2)
+                {
+                    crc16_add( m_buffer[m_buffer_index - 2], m_receiveCrc);
+                }
+                else if (m_buffer_index == 0)
+                {
+                    m_receiveCrc = 0;
+                }
+                m_buffer[m_buffer_index++] = lastByte;
+            }
+            else if (m_stream.start( m_buffer, m_buffer_index, m_receiveCrc))
+            {
+                m_stream.add( lastByte);
+            }
+            else
+            {
+                m_overflow = true;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Send a null-terminated character string.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send(const char* str)
+    {
+        while (*str)
+            send_byte( static_cast<uint8_t>( *str++));
+    }
+
+    /**
+     * Synchronize with the esp-link and wait for the result.
+     *
+     * Returns false if no response to the sync packet
+     * was received within a sane timeout. Packets that arrive while waiting
+     * are dropped.
+     * @see connect() for the non-blocking alternative.
+     */
+    template< typename Transport>
+    bool basic_client<Transport>::sync()
+    {
+        connect();
+        while (m_link_state == link_state::syncing)
+        {
+            release( try_receive());
+        }
+        return m_link_state == link_state::up;
+    }
+
+    template< typename Transport>
+    void basic_client<Transport>::connect()
+    {
+        clear_input();
+        m_retry_delay = sync_retry_min_ms;
+        start_sync();
+    }
+
+    /**
+     * Send a sync request without waiting for the response.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::start_sync()
+    {
+        TRACE_INFO( trace_events::sync, 0);
+        ++m_statistics.syncs;
+
+        // whatever we were waiting for will not arrive anymore, and
+        // the esp-link will not use the callbacks it knew about.
+        // The state is 'down' while cancelling, so that the completion of an
+        // earlier sync request does nothing.
+        m_link_state = link_state::down;
+        m_requests.cancel_all();
+        m_callbacks.clear();
+
+        send_direct( detail::SLIP_END);
+        m_link_state = link_state::syncing;
+        execute_async( esp_link::sync, [this]( bool ok, bool){ sync_done( ok);});
+    }
+
+    /**
+     * Handle the response to a sync request, or its absence.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::sync_done( bool ok)
+    {
+        if (m_link_state != link_state::syncing) return;
+
+        if (ok)
+        {
+            m_link_state = link_state::up;
+            m_retry_delay = sync_retry_min_ms;
+            m_on_link_up();
+        }
+        else
+        {
+            m_link_state = link_state::backoff;
+            m_retry_at = timing::clock::now_ms() + m_retry_delay;
+            m_retry_delay = m_retry_delay < sync_retry_max_ms / 2 ? m_retry_delay * 2 : sync_retry_max_ms;
+        }
+    }
+
+    /**
+     * Decode a packet from a sequence of bytes received.
+     *
+     * If the packet contains a SYNC command then this function will
+     * start a new synchronization, without waiting for its result. If the packet is a response
+     * value, the corresponding pending request will be completed. If the packet contains a
+     * RESP_CB, this function will look up the callback value in the callback
+     * registry, and if a registered callback was found there, it will invoke that
+     * callback. Callback packets for handles that were removed, or that were handed
+     * out before the last sync, are ignored.
+     */
+    template< typename Transport>
+    const esp_link::packet* basic_client<Transport>::decode_packet(
+            const uint8_t*  buffer,
+            uint8_t         size)
+    {
+        auto p = check_packet( buffer, size);
+        if (p)
+        {
+            m_packets.set_size( buffer, size - 2);
+            if ( p->cmd == commands::CMD_SYNC)
+            {
+                start_sync();
+                return nullptr;
+            }
+            else if( p->cmd == commands::CMD_RESP_V)
+            {
+                // complete the request that this is a response to, but also return
+                // the packet, for callers that wait for it with receive().
+                m_requests.complete( p);
+            }
+            else if( p->cmd == commands::CMD_RESP_CB)
+            {
+                if (auto registered = m_callbacks.find( p->value))
+                {
+                    // invoke a copy, the callback may unregister itself.
+                    callback_type f = *registered;
+                    f( p);
+                }
+                else
+                {
+                    ++m_statistics.unknown_callbacks;
+                    TRACE_INFO( trace_events::unknown_callback, p->value);
+                }
+                return nullptr;
+            }
+        }
+        return p;
+    }
+
+    /**
+     * Send a textual representation of a received packet to the serial port.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::log_packet(const esp_link::packet *p)
+    {
+        char buffer[10];
+        if (!p)
+        {
+            send( "Null\n");
+        }
+        else
+        {
+            send( "command: " );
+            send( itoa( p->cmd, buffer, 10));
+            send( " value: ");
+            send( itoa( p->value, buffer, 10));
+            send( "\n");
+        }
+    }
+
+    /**
+     * Check a sequence of bytes for a correct checksum.
+     *
+     * The checksum of the received bytes has already been calculated
+     * by try_receive() while they arrived, so this only compares
+     * it to the crc at the end of the frame.
+     */
+    template< typename Transport>
+    const esp_link::packet* basic_client<Transport>::check_packet(
+            const uint8_t*  buffer,
+            uint8_t         size)
+    {
+
+        if (size < 8) return nullptr;
+
+        const uint16_t crc = buffer[size - 2] | (buffer[size - 1] << 8);
+        if (crc != m_receiveCrc)
+        {
+            ++m_statistics.crc_errors;
+            TRACE_ERROR( trace_events::crc_error, size);
+            return nullptr;
+        }
+        else
+        {
+            auto p = reinterpret_cast<const packet*>( buffer);
+            ++m_statistics.packets_received;
+            TRACE_DEBUG( trace_events::packet, p->cmd);
+            return p;
+        }
+    }
+
+    /**
+     * Send a sequence of bytes indicated by a pointer to the start of
+     * the sequence and the sequence size.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send_bytes(const uint8_t* buffer, uint16_t size)
+    {
+        while (size)
+        {
+            crc16_add( *buffer, m_runningCrc);
+            send_byte( *buffer);
+            --size;
+            ++buffer;
+        }
+    }
+
+    /**
+     * Clear the input buffer of the uart.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::clear_input()
+    {
+        while (m_uart->data_available())
+            m_uart->get();
+    }
+
+    /**
+     * Wait until a byte is available on the serial port, or until a deadline has passed.
+     * Returns false in the latter case.
+     */
+    template< typename Transport>
+    bool basic_client<Transport>::wait_for_byte(uint32_t start_us, uint32_t timeout_us)
+    {
+        while (!m_uart->data_available())
+        {
+            if (timing::clock::now_us() - start_us >= timeout_us) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Wait a limited time for an incoming byte on the serial port.
+     */
+    template< typename Transport>
+    bool basic_client<Transport>::receive_byte(uint8_t& value, uint32_t timeout_us) ///< timeout in microseconds
+    {
+        const uint32_t start = timing::clock::now_us();
+        if (!wait_for_byte( start, timeout_us)) return false;
+
+        value = m_uart->get();
+
+        if (value == detail::SLIP_ESC)
+        {
+            if (!wait_for_byte( start, timeout_us)) return false;
+
+            value = m_uart->get();
+            if (value == detail::SLIP_ESC_END) value = detail::SLIP_END;
+            if (value == detail::SLIP_ESC_ESC) value = detail::SLIP_ESC;
+        }
+
+        return true;
+    }
+
+    /**
+     * Wait, potentially forever, until a byte arrives at the serial port
+     * and return that bytes value.
+     */
+    template< typename Transport>
+    uint8_t basic_client<Transport>::receive_byte_w()
+    {
+        uint8_t result = 0;
+        while (!receive_byte( result))
+            /* wait */
+            ;
+
+        return result;
+    }
+
+    /**
+     * Send a byte value as a hex string.
+     * Useful for debugging.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send_hex( uint8_t value)
+    {
+        constexpr char digits[] = {
+                '0', '1', '2', '3',
+                '4', '5', '6', '7',
+                '8', '9', 'a', 'b',
+                'c', 'd', 'e', 'f',
+        };
+        m_uart->send( (uint8_t)digits[value / 16]);
+        m_uart->send( (uint8_t)digits[value % 16]);
+        m_uart->send( (uint8_t)' ');
+    }
+
+    /**
+     * Send a byte directly to the uart, without SLIP
+     * ESCAPEing.
+     *
+     * If there is a transmit queue, the byte is added to the queue instead
+     * and the transmit interrupt will send it to the uart. This will only block
+     * if the queue is full.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send_direct(uint8_t value)
+    {
+        //send_hex( value);
+        ++m_statistics.bytes_sent;
+    #if ESP_LINK_TX_BUFFER_SIZE
+        while (!m_tx_queue.push( value))
+        {
+    #ifndef __AVR__
+            // there's no interrupt to make room on the host,
+            // so do its work here.
+            uint8_t pending;
+            if (next_tx_byte( pending)) m_uart->send( pending);
+    #endif
+        }
+        tx_interrupt::enable();
+    #else
+        m_uart->send( value);
+    #endif
+    }
+
+    /**
+     * Send a complete frame from flash memory to the uart.
+     *
+     * The frame must already contain all SLIP escapes, framing bytes and the crc.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send_frame_P(const uint8_t* frame, uint16_t size)
+    {
+        while (size--)
+        {
+            send_direct( pgm_read_byte( frame++));
+        }
+    }
+
+    /**
+     * Send a byte to the uart, but perform proper
+     * escaping of detail::SLIP_END characters in the data.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send_byte(uint8_t value)
+    {
+        switch (value)
+        {
+        case detail::SLIP_END:
+            send_direct( detail::SLIP_ESC);
+            send_direct( detail::SLIP_ESC_END);
+            break;
+        case detail::SLIP_ESC:
+            send_direct( detail::SLIP_ESC);
+            send_direct( detail::SLIP_ESC_ESC);
+            break;
+        default:
+            send_direct( value);
+        }
+    }
+
+    /**
+     * Calculate the next crc16 value given an accumulator and a new value.
+     *
+     * The actual implementation is selected at compile time.
+     * @see crc16.hpp
+     */
+    template< typename Transport>
+    void basic_client<Transport>::crc16_add(uint8_t value, uint16_t &accumulator)
+    {
+        crc16::engine::add( value, accumulator);
+    }
+
+    /**
+     * Send the header for a request (command) to the esp-link.
+     *
+     * A request consists of a request header, parameters and a two
+     * byte crc code. This function sends the header.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::send_request_header(uint16_t command, uint32_t value,
+            uint16_t argcount)
+    {
+        //clear_input();
+        send_direct( detail::SLIP_END);
+        m_runningCrc = 0;
+        send_binary( command);
+        send_binary( argcount);
+        send_binary( value);
+    }
+
+    /**
+     * Send the last bytes of a request.
+     *
+     * This means sending the crc and a detail::SLIP_END
+     * character.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::finalize_request()
+    {
+        // make a copy of the running crc because
+        // send_binary() will change it.
+        auto crc = m_runningCrc;
+        send_binary( crc);
+        send_direct( detail::SLIP_END);
+    }
+
+    template< typename Transport>
+    void basic_client<Transport>::send_padding(uint16_t length)
+    {
+        uint8_t pad = (4 - (length & 3)) & 3;
+        while (pad--)
+        {
+            crc16_add( 0, m_runningCrc);
+            send_direct( 0);
+        }
+    }
+
+    /**
+     * Send a parameter to the esp-link.
+     * A parameter is always sent as a 2-byte size value, followed by the bytes
+     * of the actual parameter.
+     *
+     * The size is, as all binary numbers, transmitted as little endian.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter_bytes(const uint8_t* data, uint16_t length)
+    {
+        send_binary( length);
+        send_bytes( data, length);
+        send_padding( length);
+    }
+
+    /**
+     * Send a parameter of which the bytes reside in flash memory.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter_bytes_P(const uint8_t* data, uint16_t length)
+    {
+        send_binary( length);
+        for (uint16_t count = length; count; --count)
+        {
+            const uint8_t value = pgm_read_byte( data);
+            ++data;
+            crc16_add( value, m_runningCrc);
+            send_byte( value);
+        }
+        send_padding( length);
+    }
+
+    /**
+     * Send a callback parameter to the esp-link.
+     * Callbacks are represented by 32-bit integers.
+     *
+     * To prevent arbitrary code execution, the callback is registered
+     * in a table and it is actually a handle to the table position that is
+     * sent to the esp as a callback value.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<callback>, callback_type func)
+    {
+        add_parameter( register_callback( func));
+    }
+
+    /**
+     * Send a callback that was registered before with register_callback().
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<callback>, uint32_t handle)
+    {
+        add_parameter( handle);
+    }
+
+    /**
+     * Send a string parameter to the esp-link.
+     * This overload accepts a const char * for the string.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<string>, const char* string)
+    {
+        add_parameter_bytes( reinterpret_cast<const uint8_t*>( string),
+                strlen( string));
+    }
+
+    /**
+     * Send a string that resides in flash memory to the esp-link.
+     *
+     * This function is much like the const char* overload, except that this one
+     * expects a zero-terminated string in flash memory
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<string>, const flash_string::helper* string)
+    {
+        auto buffer_ptr = reinterpret_cast< const char *>( string);
+        add_parameter_bytes_P( reinterpret_cast<const uint8_t *>( buffer_ptr), strlen_P( buffer_ptr));
+    }
+
+    /**
+     * This implements a special case where some strings are sent normally
+     * (i.e. a 16-bit size followed by the bytes of the string), but with an added
+     * parameter that again holds the size of the string.
+     *
+     * This is notably the case for MQTT::publish commands, where the second string
+     * must be sent as follows:
+     * (normal string)
+     * <size> <char> <char> <char>... (<size> chars, padded to a multiple of 4)
+     * 02 00 <size> (the size again, as a 2-byte parameter)
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<string_with_extra_len>, const char* string)
+    {
+        uint16_t len = strlen( string);
+        add_parameter_bytes( reinterpret_cast<const uint8_t*>( string), len);
+        add_parameter( len);
+    }
+
+    /**
+     * Send a string that resides in flash memory as a string with an extra length parameter.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<string_with_extra_len>, const flash_string::helper* string)
+    {
+        auto buffer_ptr = reinterpret_cast< const char *>( string);
+        const uint16_t length = strlen_P( buffer_ptr);
+        add_parameter_bytes_P( reinterpret_cast<const uint8_t *>( buffer_ptr), length);
+        add_parameter( length);
+    }
+
+    /**
+     * Send a payload as a string with an extra length parameter.
+     *
+     * The bytes of the payload are sent as they are produced, so a payload of any
+     * size can be sent without first storing it in memory.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<string_with_extra_len>, payload bytes)
+    {
+        send_binary( bytes.length);
+        for (uint16_t count = bytes.length; count; --count)
+        {
+            const uint8_t value = bytes.next();
+            crc16_add( value, m_runningCrc);
+            send_byte( value);
+        }
+        send_padding( bytes.length);
+        add_parameter( bytes.length);
+    }
+
+    /**
+     * Send a sequence of bytes from RAM. The bytes may contain zeros.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<binary>, span bytes)
+    {
+        add_parameter_bytes( bytes.data, bytes.size);
+    }
+
+    /**
+     * Send a sequence of bytes from flash memory. The bytes may contain zeros.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<binary>, span_P bytes)
+    {
+        add_parameter_bytes_P( bytes.data, bytes.size);
+    }
+
+    /**
+     * Send a sequence of bytes from RAM, followed by its size as an extra parameter.
+     *
+     * @see add_parameter(tag<string_with_extra_len>, const char*)
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<binary_with_extra_len>, span bytes)
+    {
+        add_parameter_bytes( bytes.data, bytes.size);
+        add_parameter( bytes.size);
+    }
+
+    /**
+     * Send a sequence of bytes from flash memory, followed by its size as an extra parameter.
+     */
+    template< typename Transport>
+    void basic_client<Transport>::add_parameter(tag<binary_with_extra_len>, span_P bytes)
+    {
+        add_parameter_bytes_P( bytes.data, bytes.size);
+        add_parameter( bytes.size);
+    }
+
+    /// The client on the default uart.
+    using client = basic_client< serial::uart<>>;
 }
 
 #endif /* ESP_LINK_CLIENT_HPP_ */
@@ -80,6 +80,8 @@ struct return_type
 struct ack {};    /// return bool to indicate whether an ack package arrived
 struct string {}; /// accept any string type as argument
 struct string_with_extra_len {};
+struct binary {}; /// accept a span or span_P as argument
+struct binary_with_extra_len {};
 struct callback {};
 
 template<>
@@ -101,6 +103,20 @@ namespace {
             commands::CMD_GET_TIME,
             uint32_t()>
         get_time;
+
+    /// Returns the wifi status of the esp-link, @see wifi_status.
+    constexpr
+        command<
+            commands::CMD_WIFI_STATUS,
+            uint8_t()>
+        get_wifi_status;
+
+    /// Ask the esp-link to send the current state of the events that callbacks were registered for.
+    constexpr
+        command<
+            commands::CMD_CB_EVENTS,
+            void()>
+        callback_events;
 }
 
 namespace mqtt
@@ -123,6 +139,12 @@ namespace {
             commands::CMD_MQTT_PUBLISH,
             void ( string, string_with_extra_len, uint8_t, uint8_t)>
         publish;
+
+    constexpr
+        command<
+            commands::CMD_MQTT_PUBLISH,
+            void ( string, binary_with_extra_len, uint8_t, uint8_t)>
+        publish_binary;
     }
 }
 }
@@ -0,0 +1,134 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_CONNECTION_TRACKER_HPP_
+#define ESP_LINK_CONNECTION_TRACKER_HPP_
+#include "client.hpp"
+#include "command.hpp"
+#include "function/function.hpp"
+
+#include <avr_utilities/flash_string.hpp>
+#include <stdint.h>
+
+namespace esp_link
+{
+    /// Wifi status of the esp-link, as reported by CMD_WIFI_STATUS and the "wifiCb" callback.
+    enum class wifi_status : uint8_t
+    {
+        idle,
+        connecting,
+        wrong_password,
+        no_ap_found,
+        connect_fail,
+        got_ip,
+        unknown = 0xff  ///< not reported yet
+    };
+
+    /**
+     * Tracker of whether the MQTT broker can be reached through the esp-link.
+     *
+     * The broker is reachable when the link with the esp-link is up and the esp-link reported that
+     * it is connected to the broker. The tracker learns about the latter through the
+     * connected and disconnected callbacks of mqtt::setup and through the wifi status callback of
+     * the esp-link, which is why start() takes care of the MQTT setup.
+     *
+     * @code{.cpp}
+     * esp_link::connection_tracker<esp_link::client> broker( esp);
+     *
+     * esp.on_link_up( []{ broker.start( topics::dispatcher( esp));});
+     * broker.on_change( []( bool reachable){ if (reachable) topics::subscribe_all( esp);});
+     * @endcode
+     *
+     * The change handler is called once for every time the broker becomes reachable and once for every time
+     * the esp-link reports that it is no longer reachable. When the link itself goes down, the handler
+     * is called when the link comes up again, but broker_reachable() returns false immediately.
+     */
+    template< typename Client>
+    class connection_tracker
+    {
+    public:
+        using callback_type  = typename Client::callback_type;
+        using change_handler = function::function<void (bool reachable)>;
+
+        explicit connection_tracker( Client &client)
+        : m_client{ &client}
+        {
+        }
+
+        /**
+         * Register the callbacks for wifi and broker events with the esp-link and set up MQTT,
+         * with on_data as the callback for MQTT messages. Call this every time the link comes up.
+         */
+        void start( callback_type on_data = callback_type{})
+        {
+            // the esp-link forgot everything, so the broker is unreachable until it says otherwise.
+            m_wifi = wifi_status::unknown;
+            m_mqtt_connected = false;
+            update();
+
+            m_client->add_named_callback( F_("wifiCb"),
+                    [this]( const packet *p){ set_wifi( m_client->arguments( p)[0].template as<uint8_t>( 0xff));});
+            m_client->execute( mqtt::setup,
+                    callback_type{ [this]( const packet *){ set_mqtt_connected( true);}},
+                    callback_type{ [this]( const packet *){ set_mqtt_connected( false);}},
+                    callback_type{},
+                    on_data);
+            m_client->execute_async( get_wifi_status,
+                    [this]( bool ok, uint8_t status){ if (ok) set_wifi( status);});
+        }
+
+        /// Set the function that is called when the broker becomes reachable or unreachable.
+        void on_change( change_handler handler)
+        {
+            m_on_change = handler;
+        }
+
+        bool broker_reachable() const
+        {
+            return m_client->state() == link_state::up and m_mqtt_connected;
+        }
+
+        wifi_status wifi() const
+        {
+            return m_wifi;
+        }
+
+    private:
+        void set_wifi( uint8_t status)
+        {
+            m_wifi = static_cast<wifi_status>( status);
+
+            // the esp-link reports a lost broker connection only after a timeout.
+            if (m_wifi != wifi_status::got_ip and m_wifi != wifi_status::unknown) m_mqtt_connected = false;
+            update();
+        }
+
+        void set_mqtt_connected( bool connected)
+        {
+            m_mqtt_connected = connected;
+            update();
+        }
+
+        void update()
+        {
+            const bool reachable = broker_reachable();
+            if (reachable != m_reported)
+            {
+                m_reported = reachable;
+                m_on_change( reachable);
+            }
+        }
+
+        Client          *m_client;
+        change_handler  m_on_change;
+        wifi_status     m_wifi = wifi_status::unknown;
+        bool            m_mqtt_connected = false;
+        bool            m_reported = false;     ///< reachability as last passed to the change handler
+    };
+}
+
+#endif /* ESP_LINK_CONNECTION_TRACKER_HPP_ */
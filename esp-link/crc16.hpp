@@ -0,0 +1,192 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_CRC16_HPP_
+#define ESP_LINK_CRC16_HPP_
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/**
+ * This file contains the crc16 (CCITT, as used by esp-link) implementations.
+ *
+ * All engines compute exactly the same checksum, but make different trade-offs
+ * between speed and flash usage:
+ *  - bitwise: five shift/xor steps per byte, no tables at all,
+ *  - table:   a single lookup per byte in a 256-entry (512 byte) flash table,
+ *  - nibble:  two lookups per byte in two 16-entry (64 bytes in total) flash tables.
+ *
+ * The engine that the client uses is selected at compile time by defining
+ * ESP_LINK_CRC16 as one of the ESP_LINK_CRC16_... values below. The default is the
+ * table engine. Tables are only instantiated (and only take up flash) if the
+ * corresponding engine is used.
+ */
+#define ESP_LINK_CRC16_BITWISE  1
+#define ESP_LINK_CRC16_TABLE    2
+#define ESP_LINK_CRC16_NIBBLE   3
+
+#ifndef ESP_LINK_CRC16
+#define ESP_LINK_CRC16 ESP_LINK_CRC16_TABLE
+#endif
+
+namespace esp_link
+{
+namespace crc16
+{
+    namespace detail
+    {
+        constexpr uint16_t swap( uint16_t a)
+        {
+            return static_cast<uint16_t>( (a >> 8) | (a << 8));
+        }
+
+        constexpr uint16_t step3( uint16_t a)
+        {
+            return a ^ ((a & 0xff00) >> 5);
+        }
+
+        constexpr uint16_t step2( uint16_t a)
+        {
+            return step3( a ^ ((a >> 8) >> 4));
+        }
+
+        constexpr uint16_t step1( uint16_t a)
+        {
+            return step2( static_cast<uint16_t>( a ^ ((a & 0xff00) << 4)));
+        }
+
+        /// Lookup tables. These are templates so that they only end up in flash
+        /// when they are actually used.
+        template< typename Dummy = void>
+        struct tables
+        {
+            static const uint16_t bytes[256];
+            static const uint16_t low_nibbles[16];
+            static const uint16_t high_nibbles[16];
+        };
+
+        template< typename Dummy>
+        const uint16_t tables<Dummy>::bytes[256] PROGMEM = {
+            0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+            0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+            0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+            0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+            0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+            0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+            0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+            0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+            0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+            0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+            0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+            0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+            0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+            0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+            0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+            0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+            0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+            0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+            0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+            0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+            0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+            0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+            0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+            0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+            0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+            0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+            0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+            0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+            0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+            0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+            0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+            0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+        };
+
+        template< typename Dummy>
+        const uint16_t tables<Dummy>::low_nibbles[16] PROGMEM = {
+            0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+            0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+        };
+
+        template< typename Dummy>
+        const uint16_t tables<Dummy>::high_nibbles[16] PROGMEM = {
+            0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+            0x8408, 0x9489, 0xa50a, 0xb58b, 0xc60c, 0xd68d, 0xe70e, 0xf78f,
+        };
+    }
+
+    /**
+     * Compile-time version of a single crc step.
+     *
+     * This computes the same value as bitwise::add(), but as a constexpr function,
+     * so that checksums of constant data can be calculated by the compiler.
+     */
+    constexpr uint16_t update( uint16_t accumulator, uint8_t value)
+    {
+        return detail::step1( detail::swap( accumulator ^ value));
+    }
+
+    static_assert( update( 0, 0x01) == 0x1189, "crc16 step does not match the lookup tables");
+    static_assert( update( 0, 0x80) == 0x8408, "crc16 step does not match the lookup tables");
+
+    /**
+     * The original esp-link implementation: shifts and xors only.
+     */
+    struct bitwise
+    {
+        static void add( uint8_t value, uint16_t &accumulator)
+        {
+            accumulator ^= value;
+            accumulator  = (accumulator >> 8) | (accumulator << 8);
+            accumulator ^= (accumulator & 0xff00) << 4;
+            accumulator ^= (accumulator >> 8) >> 4;
+            accumulator ^= (accumulator & 0xff00) >> 5;
+        }
+    };
+
+    /**
+     * One table lookup per byte.
+     *
+     * The crc step is linear, the high byte of the accumulator just ends up
+     * in the low byte and the low byte (xor-ed with the value) determines
+     * the rest, which is what the table holds.
+     */
+    struct table
+    {
+        static void add( uint8_t value, uint16_t &accumulator)
+        {
+            const uint8_t index = static_cast<uint8_t>( accumulator) ^ value;
+            accumulator = (accumulator >> 8) ^ pgm_read_word( &detail::tables<>::bytes[index]);
+        }
+    };
+
+    /**
+     * Like the table engine, but the table entry is composed of the
+     * entries for the low and the high nibble of the index.
+     */
+    struct nibble
+    {
+        static void add( uint8_t value, uint16_t &accumulator)
+        {
+            const uint8_t index = static_cast<uint8_t>( accumulator) ^ value;
+            accumulator = (accumulator >> 8)
+                    ^ pgm_read_word( &detail::tables<>::low_nibbles[index & 0x0f])
+                    ^ pgm_read_word( &detail::tables<>::high_nibbles[index >> 4]);
+        }
+    };
+
+#if ESP_LINK_CRC16 == ESP_LINK_CRC16_BITWISE
+    using engine = bitwise;
+#elif ESP_LINK_CRC16 == ESP_LINK_CRC16_TABLE
+    using engine = table;
+#elif ESP_LINK_CRC16 == ESP_LINK_CRC16_NIBBLE
+    using engine = nibble;
+#else
+#error "ESP_LINK_CRC16 should be one of ESP_LINK_CRC16_BITWISE, ESP_LINK_CRC16_TABLE or ESP_LINK_CRC16_NIBBLE"
+#endif
+}
+}
+
+#endif /* ESP_LINK_CRC16_HPP_ */
@@ -0,0 +1,61 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_EEPROM_STORE_HPP_
+#define ESP_LINK_EEPROM_STORE_HPP_
+#include <avr/eeprom.h>
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * A region of Size bytes of EEPROM, starting at address Offset.
+     *
+     * Addresses passed to read() and write() are relative to the start of the region.
+     * Writes only touch bytes that actually change, to spare the EEPROM.
+     * In the host build, the EEPROM is a file (@see host/include/avr/eeprom.h).
+     */
+    template< uint16_t Offset, uint16_t Size>
+    struct eeprom_store
+    {
+        static_assert( Offset + Size <= E2END + 1, "EEPROM region does not fit in the EEPROM");
+
+        static constexpr uint16_t size = Size;
+
+        static void read( uint16_t address, void *data, uint8_t count)
+        {
+            eeprom_read_block( data, location( address), count);
+        }
+
+        static void write( uint16_t address, const void *data, uint8_t count)
+        {
+            eeprom_update_block( data, location( address), count);
+        }
+
+    private:
+        static void *location( uint16_t address)
+        {
+            return reinterpret_cast<void *>( static_cast<uintptr_t>( Offset + address));
+        }
+    };
+
+    /// A store without any room, for users of stores that should not use the EEPROM.
+    struct no_store
+    {
+        static constexpr uint16_t size = 0;
+
+        static void read( uint16_t, void *, uint8_t)
+        {
+        }
+
+        static void write( uint16_t, const void *, uint8_t)
+        {
+        }
+    };
+}
+
+#endif /* ESP_LINK_EEPROM_STORE_HPP_ */
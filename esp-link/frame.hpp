@@ -0,0 +1,354 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_FRAME_HPP_
+#define ESP_LINK_FRAME_HPP_
+#include "command.hpp"
+#include "crc16.hpp"
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/**
+ * This file contains the machinery to compute complete esp-link frames at compile time.
+ *
+ * If all arguments of a command are known at compile time, every byte of the frame
+ * that execute() would send, including SLIP escapes and the crc, is known as well.
+ * make_frame() computes such a frame from a command<> instantiation and compile time
+ * arguments. The resulting frame lives in flash and can be sent with client::send_frame(),
+ * which just copies the bytes to the uart.
+ *
+ * String arguments are created with the ESP_LINK_STRING() macro, integer arguments
+ * with the constant<> template:
+ *
+ * @code{.cpp}
+ * esp.send_frame(
+ *      esp_link::make_frame( esp_link::mqtt::subscribe, ESP_LINK_STRING( "/spider/LED"), esp_link::constant<0>{}));
+ * @endcode
+ *
+ * Callbacks can not be part of a precomputed frame, and neither can commands with a return value:
+ * execute() sends a new request id in the header of every such request, so that the response can
+ * be matched with the request.
+ */
+namespace esp_link
+{
+    /// A sequence of bytes, as template arguments.
+    template< uint8_t... Bytes>
+    struct bytes
+    {
+    };
+
+    /**
+     * A complete, SLIP-encoded frame.
+     * The bytes of the frame are stored in flash.
+     */
+    template< uint8_t... Bytes>
+    struct frame
+    {
+        static constexpr uint16_t size = sizeof...( Bytes);
+        static const uint8_t data[sizeof...( Bytes)];
+    };
+
+    template< uint8_t... Bytes>
+    const uint8_t frame<Bytes...>::data[sizeof...( Bytes)] PROGMEM = { Bytes...};
+
+    /**
+     * A string as template arguments. Use the ESP_LINK_STRING() macro to create these.
+     *
+     * The string is also available as a zero-terminated string in flash.
+     */
+    template< char... Chars>
+    struct static_string
+    {
+        static constexpr uint16_t size = sizeof...( Chars);
+        static const char data[sizeof...( Chars) + 1];
+    };
+
+    template< char... Chars>
+    const char static_string<Chars...>::data[sizeof...( Chars) + 1] PROGMEM = { Chars..., '\0'};
+
+    /**
+     * An integer argument value that is known at compile time.
+     * The number of bytes that are sent is determined by the parameter
+     * type of the command.
+     */
+    template< uint32_t Value>
+    struct constant
+    {
+    };
+
+    namespace detail
+    {
+        constexpr uint8_t SLIP_END     = 0xC0;
+        constexpr uint8_t SLIP_ESC     = 0xDB;
+        constexpr uint8_t SLIP_ESC_END = 0xDC;
+        constexpr uint8_t SLIP_ESC_ESC = 0xDD;
+
+        // concatenation of byte sequences
+        template< typename... Sequences>
+        struct concat;
+
+        template< typename Sequence>
+        struct concat<Sequence>
+        {
+            using type = Sequence;
+        };
+
+        template< uint8_t... Left, uint8_t... Right, typename... Tail>
+        struct concat< bytes<Left...>, bytes<Right...>, Tail...>
+            : concat< bytes<Left..., Right...>, Tail...>
+        {
+        };
+
+        // SLIP escaping
+        template< uint8_t Byte>
+        struct escape_byte
+        {
+            using type = bytes<Byte>;
+        };
+
+        template<>
+        struct escape_byte<SLIP_END>
+        {
+            using type = bytes<SLIP_ESC, SLIP_ESC_END>;
+        };
+
+        template<>
+        struct escape_byte<SLIP_ESC>
+        {
+            using type = bytes<SLIP_ESC, SLIP_ESC_ESC>;
+        };
+
+        template< typename Sequence>
+        struct escape;
+
+        template< uint8_t... Bytes>
+        struct escape< bytes<Bytes...>>
+            : concat< bytes<>, typename escape_byte<Bytes>::type...>
+        {
+        };
+
+        // crc over a sequence
+        constexpr uint16_t crc_of( uint16_t accumulator)
+        {
+            return accumulator;
+        }
+
+        template< typename... Tail>
+        constexpr uint16_t crc_of( uint16_t accumulator, uint8_t head, Tail... tail)
+        {
+            return crc_of( crc16::update( accumulator, head), tail...);
+        }
+
+        template< typename Sequence>
+        struct append_crc;
+
+        template< uint8_t... Bytes>
+        struct append_crc< bytes<Bytes...>>
+        {
+            static constexpr uint16_t crc = crc_of( 0, Bytes...);
+            using type = bytes< Bytes..., static_cast<uint8_t>( crc), static_cast<uint8_t>( crc >> 8)>;
+        };
+
+        // little endian representation of integers
+        template< uint32_t Value, unsigned Size>
+        struct little_endian;
+
+        template< uint32_t Value>
+        struct little_endian<Value, 1>
+        {
+            using type = bytes< static_cast<uint8_t>( Value)>;
+        };
+
+        template< uint32_t Value>
+        struct little_endian<Value, 2>
+        {
+            using type = bytes< static_cast<uint8_t>( Value), static_cast<uint8_t>( Value >> 8)>;
+        };
+
+        template< uint32_t Value>
+        struct little_endian<Value, 4>
+        {
+            using type = bytes<
+                    static_cast<uint8_t>( Value),       static_cast<uint8_t>( Value >> 8),
+                    static_cast<uint8_t>( Value >> 16), static_cast<uint8_t>( Value >> 24)>;
+        };
+
+        // zero-padding to a multiple of 4 bytes
+        template< uint16_t Length, uint8_t Pad = (4 - (Length & 3)) & 3>
+        struct padding;
+
+        template< uint16_t Length> struct padding<Length, 0> { using type = bytes<>;};
+        template< uint16_t Length> struct padding<Length, 1> { using type = bytes<0>;};
+        template< uint16_t Length> struct padding<Length, 2> { using type = bytes<0, 0>;};
+        template< uint16_t Length> struct padding<Length, 3> { using type = bytes<0, 0, 0>;};
+
+        /// A single parameter, as client::add_parameter_bytes() would send it.
+        template< uint16_t Length, typename Data>
+        struct parameter
+            : concat<
+                typename little_endian< Length, 2>::type,
+                Data,
+                typename padding<Length>::type>
+        {
+        };
+
+        /**
+         * Serialization of an argument, given the parameter type from the command prototype.
+         *
+         * The 'count' member holds the number of parameters that this adds to the packet.
+         */
+        template< typename Parameter, typename Argument>
+        struct serialize
+        {
+            static_assert( sizeof( Argument) == 0,
+                    "This argument can not be part of a precomputed frame. Use ESP_LINK_STRING() for strings and constant<> for integers");
+        };
+
+        template< typename Parameter, uint32_t Value>
+        struct serialize< Parameter, constant<Value>>
+            : parameter< sizeof( Parameter), typename little_endian<Value, sizeof( Parameter)>::type>
+        {
+            static constexpr uint16_t count = 1;
+        };
+
+        template< char... Chars>
+        struct serialize< string, static_string<Chars...>>
+            : parameter< sizeof...( Chars), bytes< static_cast<uint8_t>( Chars)...>>
+        {
+            static constexpr uint16_t count = 1;
+        };
+
+        template< char... Chars>
+        struct serialize< string_with_extra_len, static_string<Chars...>>
+            : concat<
+                typename parameter< sizeof...( Chars), bytes< static_cast<uint8_t>( Chars)...>>::type,
+                typename serialize< uint16_t, constant< sizeof...( Chars)>>::type>
+        {
+            static constexpr uint16_t count = 2;
+        };
+
+        constexpr uint16_t sum()
+        {
+            return 0;
+        }
+
+        template< typename... Tail>
+        constexpr uint16_t sum( uint16_t head, Tail... tail)
+        {
+            return head + sum( tail...);
+        }
+
+        template< typename Sequence>
+        struct to_frame;
+
+        template< uint8_t... Bytes>
+        struct to_frame< bytes<Bytes...>>
+        {
+            using type = frame< SLIP_END, Bytes..., SLIP_END>;
+        };
+
+        template< uint16_t Cmd, uint32_t Value, typename... Serialized>
+        struct build_frame
+            : to_frame<
+                typename escape<
+                    typename append_crc<
+                        typename concat<
+                            typename little_endian< Cmd, 2>::type,
+                            typename little_endian< sum( Serialized::count...), 2>::type,
+                            typename little_endian< Value, 4>::type,
+                            typename Serialized::type...
+                        >::type
+                    >::type
+                >::type
+            >
+        {
+        };
+
+        template< typename ReturnType>
+        struct is_void
+        {
+            static constexpr bool value = false;
+        };
+
+        template<>
+        struct is_void<void>
+        {
+            static constexpr bool value = true;
+        };
+
+        // conversion of a string literal to a static_string<>
+        template< unsigned N>
+        constexpr char char_at( const char (&s)[N], unsigned index)
+        {
+            return index < N ? s[index] : '\0';
+        }
+
+        template< typename String, char... Chars>
+        struct take_until_nul
+        {
+            static_assert( sizeof...( Chars) != 0, "ESP_LINK_STRING() only supports strings of up to 63 characters");
+            using type = String;
+        };
+
+        template< char... String, char... Tail>
+        struct take_until_nul< static_string<String...>, '\0', Tail...>
+        {
+            using type = static_string<String...>;
+        };
+
+        template< char... String, char Head, char... Tail>
+        struct take_until_nul< static_string<String...>, Head, Tail...>
+            : take_until_nul< static_string<String..., Head>, Tail...>
+        {
+        };
+
+        template< char... Chars>
+        using make_static_string = typename take_until_nul< static_string<>, Chars...>::type;
+    }
+
+    /**
+     * Compute the frame for the given command and arguments at compile time.
+     *
+     * The type of the returned value holds all bytes of the frame, the value itself
+     * can be passed to client::send_frame(). The value in the header of the frame is 0, like
+     * execute() sends for commands without a return value.
+     */
+    template< uint16_t Cmd, typename ReturnType, typename... Parameters, typename... Arguments>
+    constexpr typename detail::build_frame< Cmd, 0, detail::serialize< Parameters, Arguments>...>::type
+    make_frame( command<Cmd, ReturnType( Parameters...)>, Arguments...)
+    {
+        static_assert( detail::is_void<ReturnType>::value,
+                "Only commands without a return value can be precomputed, other commands need a new request id for every request");
+        return {};
+    }
+}
+
+#define ESP_LINK_STRING_CHARS( s) \
+    ::esp_link::detail::char_at( s,  0), ::esp_link::detail::char_at( s,  1), ::esp_link::detail::char_at( s,  2), ::esp_link::detail::char_at( s,  3),\
+    ::esp_link::detail::char_at( s,  4), ::esp_link::detail::char_at( s,  5), ::esp_link::detail::char_at( s,  6), ::esp_link::detail::char_at( s,  7),\
+    ::esp_link::detail::char_at( s,  8), ::esp_link::detail::char_at( s,  9), ::esp_link::detail::char_at( s, 10), ::esp_link::detail::char_at( s, 11),\
+    ::esp_link::detail::char_at( s, 12), ::esp_link::detail::char_at( s, 13), ::esp_link::detail::char_at( s, 14), ::esp_link::detail::char_at( s, 15),\
+    ::esp_link::detail::char_at( s, 16), ::esp_link::detail::char_at( s, 17), ::esp_link::detail::char_at( s, 18), ::esp_link::detail::char_at( s, 19),\
+    ::esp_link::detail::char_at( s, 20), ::esp_link::detail::char_at( s, 21), ::esp_link::detail::char_at( s, 22), ::esp_link::detail::char_at( s, 23),\
+    ::esp_link::detail::char_at( s, 24), ::esp_link::detail::char_at( s, 25), ::esp_link::detail::char_at( s, 26), ::esp_link::detail::char_at( s, 27),\
+    ::esp_link::detail::char_at( s, 28), ::esp_link::detail::char_at( s, 29), ::esp_link::detail::char_at( s, 30), ::esp_link::detail::char_at( s, 31),\
+    ::esp_link::detail::char_at( s, 32), ::esp_link::detail::char_at( s, 33), ::esp_link::detail::char_at( s, 34), ::esp_link::detail::char_at( s, 35),\
+    ::esp_link::detail::char_at( s, 36), ::esp_link::detail::char_at( s, 37), ::esp_link::detail::char_at( s, 38), ::esp_link::detail::char_at( s, 39),\
+    ::esp_link::detail::char_at( s, 40), ::esp_link::detail::char_at( s, 41), ::esp_link::detail::char_at( s, 42), ::esp_link::detail::char_at( s, 43),\
+    ::esp_link::detail::char_at( s, 44), ::esp_link::detail::char_at( s, 45), ::esp_link::detail::char_at( s, 46), ::esp_link::detail::char_at( s, 47),\
+    ::esp_link::detail::char_at( s, 48), ::esp_link::detail::char_at( s, 49), ::esp_link::detail::char_at( s, 50), ::esp_link::detail::char_at( s, 51),\
+    ::esp_link::detail::char_at( s, 52), ::esp_link::detail::char_at( s, 53), ::esp_link::detail::char_at( s, 54), ::esp_link::detail::char_at( s, 55),\
+    ::esp_link::detail::char_at( s, 56), ::esp_link::detail::char_at( s, 57), ::esp_link::detail::char_at( s, 58), ::esp_link::detail::char_at( s, 59),\
+    ::esp_link::detail::char_at( s, 60), ::esp_link::detail::char_at( s, 61), ::esp_link::detail::char_at( s, 62), ::esp_link::detail::char_at( s, 63)
+
+/// The type of a static_string<> for the given string literal, which may contain at most 63 characters.
+#define ESP_LINK_STRING_T( s) ::esp_link::detail::make_static_string< ESP_LINK_STRING_CHARS( s)>
+
+/// A static_string<> object for the given string literal, which may contain at most 63 characters.
+#define ESP_LINK_STRING( s) (ESP_LINK_STRING_T( s){})
+
+#endif /* ESP_LINK_FRAME_HPP_ */
@@ -0,0 +1,264 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_MQTT_ROUTER_HPP_
+#define ESP_LINK_MQTT_ROUTER_HPP_
+#include "arguments.hpp"
+#include "command.hpp"
+#include "frame.hpp"
+#include "packet.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+namespace esp_link
+{
+namespace mqtt
+{
+    using handler_type = void (*)( const packet *);
+
+    /**
+     * A single (topic, handler) pair for the router.
+     *
+     * Topic must be a static_string<>, as created by ESP_LINK_STRING_T().
+     */
+    template< typename Topic, handler_type Handler>
+    struct route
+    {
+    };
+
+    namespace detail
+    {
+        /// The hash function that is used for topics, both at compile time and at runtime.
+        constexpr uint16_t hash_step( uint16_t hash, uint8_t value)
+        {
+            return static_cast<uint16_t>( hash * 31 + value);
+        }
+
+        constexpr uint16_t hash_of( uint16_t hash)
+        {
+            return hash;
+        }
+
+        template< typename... Tail>
+        constexpr uint16_t hash_of( uint16_t hash, char head, Tail... tail)
+        {
+            return hash_of( hash_step( hash, static_cast<uint8_t>( head)), tail...);
+        }
+
+        inline uint16_t hash_of( uint16_t hash, const uint8_t *data, uint16_t size)
+        {
+            while (size--) hash = hash_step( hash, *data++);
+            return hash;
+        }
+
+        /// smallest power of two that is at least twice the given value
+        constexpr uint16_t table_size( uint16_t count, uint16_t size = 1)
+        {
+            return size >= 2 * count ? size : table_size( count, 2 * size);
+        }
+
+        template< uint16_t Seed, uint16_t Mask, typename Topic>
+        struct bucket;
+
+        template< uint16_t Seed, uint16_t Mask, char... Chars>
+        struct bucket< Seed, Mask, static_string<Chars...>>
+        {
+            static constexpr uint16_t value = hash_of( Seed, Chars...) & Mask;
+        };
+
+        // whether all values in a list are distinct
+        constexpr bool none_equal( uint16_t)
+        {
+            return true;
+        }
+
+        template< typename... Tail>
+        constexpr bool none_equal( uint16_t value, uint16_t head, Tail... tail)
+        {
+            return value != head and none_equal( value, tail...);
+        }
+
+        constexpr bool distinct()
+        {
+            return true;
+        }
+
+        template< typename... Tail>
+        constexpr bool distinct( uint16_t head, Tail... tail)
+        {
+            return none_equal( head, tail...) and distinct( tail...);
+        }
+
+        constexpr uint16_t max_seed = 256;
+
+        /**
+         * Find the first seed for which all topics hash to a different bucket.
+         * The search stops at max_seed.
+         */
+        template< uint16_t Seed, uint16_t Mask, bool Found, typename... Topics>
+        struct find_seed
+            : find_seed<
+                Seed + 1,
+                Mask,
+                Seed + 1 == max_seed or distinct( bucket< Seed + 1, Mask, Topics>::value...),
+                Topics...>
+        {
+        };
+
+        template< uint16_t Seed, uint16_t Mask, typename... Topics>
+        struct find_seed< Seed, Mask, true, Topics...>
+        {
+            static constexpr uint16_t value = Seed;
+        };
+
+        /// position + 1 of the first value in the list that equals 'value', or 0 if there is none.
+        constexpr uint8_t position_of( uint16_t, uint8_t)
+        {
+            return 0;
+        }
+
+        template< typename... Tail>
+        constexpr uint8_t position_of( uint16_t value, uint8_t position, uint16_t head, Tail... tail)
+        {
+            return value == head ? position + 1 : position_of( value, position + 1, tail...);
+        }
+
+        template< uint8_t... Indices>
+        struct indices
+        {
+        };
+
+        template< uint16_t Count, uint8_t... Indices>
+        struct make_indices : make_indices< Count - 1, Count - 1, Indices...>
+        {
+        };
+
+        template< uint8_t... Indices>
+        struct make_indices< 0, Indices...>
+        {
+            using type = indices< Indices...>;
+        };
+
+        template< typename Indices, uint16_t... Buckets>
+        struct slot_table;
+
+        /// Table that maps buckets to routes. An entry holds the route index + 1, or zero if
+        /// no topic hashes to that bucket.
+        template< uint8_t... Indices, uint16_t... Buckets>
+        struct slot_table< indices< Indices...>, Buckets...>
+        {
+            static const uint8_t slots[sizeof...( Indices)];
+        };
+
+        template< uint8_t... Indices, uint16_t... Buckets>
+        const uint8_t slot_table< indices< Indices...>, Buckets...>::slots[sizeof...( Indices)] PROGMEM = {
+                position_of( Indices, 0, Buckets...)...
+        };
+    }
+
+    /**
+     * Dispatcher of incoming MQTT data to handlers, based on a list of routes that is
+     * known at compile time.
+     *
+     * At compile time, a hash seed is chosen such that no two topics end up in the same
+     * bucket of the hash table. At runtime, the topic of an incoming message is hashed once
+     * and compared with the only candidate topic, which lives in flash.
+     *
+     * @code{.cpp}
+     * using topics = esp_link::mqtt::router<
+     *     esp_link::mqtt::route< ESP_LINK_STRING_T( "/spider/LED"), &on_led>,
+     *     esp_link::mqtt::route< ESP_LINK_STRING_T( "/spider/IR"),  &on_ir>
+     *     >;
+     *
+     * esp.execute( esp_link::mqtt::setup, nullptr, nullptr, nullptr, topics::dispatcher( esp));
+     * topics::subscribe_all( esp);
+     * @endcode
+     */
+    template< typename... Routes>
+    class router;
+
+    template< typename... Topics, handler_type... Handlers>
+    class router< route< Topics, Handlers>...>
+    {
+    public:
+        static constexpr uint8_t  route_count = sizeof...( Topics);
+        static constexpr uint16_t table_size  = detail::table_size( route_count);
+        static constexpr uint16_t mask        = table_size - 1;
+        static constexpr uint16_t seed        = detail::find_seed< 0, mask, detail::distinct( detail::bucket< 0, mask, Topics>::value...), Topics...>::value;
+
+        static_assert( seed != detail::max_seed, "could not find a perfect hash for these topics");
+        static_assert( route_count > 0, "a router needs at least one route");
+        static_assert( table_size <= 256, "too many routes");
+
+        /**
+         * Call the handler for the topic of an MQTT data callback packet, of which args are
+         * the arguments (@see client::arguments()).
+         *
+         * Packets for topics without a route are ignored, and so are packets whose topic
+         * argument does not fit in the packet.
+         */
+        static void dispatch( const packet *p, const argument_list &args)
+        {
+            const argument topic = args[0];
+            if (!topic) return;
+
+            const uint8_t slot = pgm_read_byte( &table::slots[ detail::hash_of( seed, topic.data, topic.size) & mask]);
+            if (!slot) return;
+
+            const uint8_t index = slot - 1;
+            if (    topic.size != pgm_read_byte( &lengths[index])
+                or  memcmp_P( topic.data, pgm_read_ptr( &topic_strings[index]), topic.size) != 0)
+            {
+                return;
+            }
+
+            reinterpret_cast<handler_type>( pgm_read_ptr( &handlers[index]))( p);
+        }
+
+        /**
+         * Return a callback that dispatches the MQTT data packets that the given client receives,
+         * to be registered as the data callback of mqtt::setup.
+         */
+        template< typename Client>
+        static typename Client::callback_type dispatcher( Client &client)
+        {
+            return [&client]( const packet *p){ if (p) dispatch( p, client.arguments( p));};
+        }
+
+        /**
+         * Subscribe to all topics of this router, using precomputed frames.
+         */
+        template< uint8_t Qos = 0, typename Client>
+        static void subscribe_all( Client &client)
+        {
+            (void)((int[]){0, (client.send_frame( make_frame( subscribe, Topics{}, constant<Qos>{})), 0)...});
+        }
+
+    private:
+        using table = detail::slot_table<
+                typename detail::make_indices< table_size>::type,
+                detail::bucket< seed, mask, Topics>::value...>;
+
+        static const uint8_t        lengths[route_count];
+        static const char * const   topic_strings[route_count];
+        static const handler_type   handlers[route_count];
+    };
+
+    template< typename... Topics, handler_type... Handlers>
+    const uint8_t router< route< Topics, Handlers>...>::lengths[route_count] PROGMEM = { Topics::size...};
+
+    template< typename... Topics, handler_type... Handlers>
+    const char * const router< route< Topics, Handlers>...>::topic_strings[route_count] PROGMEM = { Topics::data...};
+
+    template< typename... Topics, handler_type... Handlers>
+    const handler_type router< route< Topics, Handlers>...>::handlers[route_count] PROGMEM = { Handlers...};
+}
+}
+
+#endif /* ESP_LINK_MQTT_ROUTER_HPP_ */
@@ -0,0 +1,23 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_PACKET_HPP_
+#define ESP_LINK_PACKET_HPP_
+#include <stdint.h>
+
+namespace esp_link
+{
+    struct packet
+    {
+        uint16_t cmd;            /**< Command to execute */
+        uint16_t argc;           /**< Number of arguments */
+        uint32_t value;          /**< Callback to invoke, NULL if none; or response value */
+        uint8_t  args[0];        /**< Arguments */
+    };
+}
+
+#endif /* ESP_LINK_PACKET_HPP_ */
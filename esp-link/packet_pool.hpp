@@ -0,0 +1,120 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_PACKET_POOL_HPP_
+#define ESP_LINK_PACKET_POOL_HPP_
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * A fixed set of receive buffers ("slots") of SlotSize bytes each.
+     *
+     * A slot is acquired by the receiver before it starts storing a packet and
+     * stays in use until it is explicitly released, so a packet that was handed
+     * out remains valid while the next one is being received in another slot.
+     *
+     * Slots are handed out in round-robin order.
+     */
+    template< uint8_t SlotCount, uint8_t SlotSize>
+    class packet_pool
+    {
+    public:
+        static_assert( SlotCount > 0 and SlotCount <= 8, "a packet pool should have between 1 and 8 slots");
+
+        static constexpr uint8_t slot_size = SlotSize;
+
+        /**
+         * Find a free slot, mark it as used and return a pointer to its buffer.
+         * Returns nullptr if all slots are in use.
+         */
+        uint8_t *acquire()
+        {
+            uint8_t index = m_next;
+            for (uint8_t count = 0; count < SlotCount; ++count)
+            {
+                const uint8_t mask = 1 << index;
+                if (!(m_in_use & mask))
+                {
+                    m_in_use |= mask;
+                    m_next = next( index);
+                    return m_slots[index].data;
+                }
+                index = next( index);
+            }
+            return nullptr;
+        }
+
+        /**
+         * Return a slot to the pool. The argument may point anywhere into the
+         * slot's buffer. Pointers that do not point into this pool are ignored.
+         */
+        void release( const void *buffer)
+        {
+            const uint8_t index = index_of( buffer);
+            if (index < SlotCount) m_in_use &= ~(1 << index);
+        }
+
+        /**
+         * Record the number of bytes that were received in a slot.
+         */
+        void set_size( const void *buffer, uint8_t size)
+        {
+            const uint8_t index = index_of( buffer);
+            if (index < SlotCount) m_sizes[index] = size;
+        }
+
+        /**
+         * Return the number of bytes that were received in a slot, as recorded with set_size().
+         * Returns zero for pointers that do not point into this pool.
+         */
+        uint8_t size_of( const void *buffer) const
+        {
+            const uint8_t index = index_of( buffer);
+            return index < SlotCount ? m_sizes[index] : 0;
+        }
+
+        /// number of slots that are currently in use
+        uint8_t in_use() const
+        {
+            uint8_t count = 0;
+            for (uint8_t bits = m_in_use; bits; bits &= bits - 1) ++count;
+            return count;
+        }
+
+    private:
+        static uint8_t next( uint8_t index)
+        {
+            return index + 1 == SlotCount ? 0 : index + 1;
+        }
+
+        /// return the index of the slot that buffer points into, or SlotCount
+        /// if it does not point into this pool.
+        uint8_t index_of( const void *buffer) const
+        {
+            const uint8_t *byte_ptr = static_cast<const uint8_t *>( buffer);
+            const uint8_t *begin    = m_slots[0].data;
+            if (byte_ptr < begin or byte_ptr >= begin + sizeof m_slots) return SlotCount;
+
+            return (byte_ptr - begin) / sizeof( slot);
+        }
+
+        struct slot
+        {
+            // packets start with 32-bit values, make sure they can be read directly
+            // on hosts that care about alignment.
+            alignas( uint32_t) uint8_t data[SlotSize];
+        };
+
+        slot    m_slots[SlotCount];
+        uint8_t m_sizes[SlotCount] = {};
+        uint8_t m_in_use = 0;
+        uint8_t m_next   = 0;
+    };
+}
+
+#endif /* ESP_LINK_PACKET_POOL_HPP_ */
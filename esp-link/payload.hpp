@@ -0,0 +1,76 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_PAYLOAD_HPP_
+#define ESP_LINK_PAYLOAD_HPP_
+#include "ring_buffer.hpp"
+#include "function/function.hpp"
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * A sequence of bytes with a known length that is produced while it is being sent.
+     *
+     * The client calls 'next' exactly 'length' times and sends every byte it returns right away,
+     * so the payload never needs to exist in RAM as a whole. This can be used
+     * as the message argument of mqtt::publish:
+     *
+     * @code{.cpp}
+     * uint8_t count = 0;
+     * esp.execute( mqtt::publish, "/spider/count", esp_link::payload{ 200, [&count]{ return '0' + count++ % 10;}}, 0, 0);
+     * @endcode
+     */
+    struct payload
+    {
+        using producer_type = function::function<uint8_t ()>;
+
+        uint16_t        length;
+        producer_type   next;
+    };
+
+    /// Payload that consists of 'length' bytes in RAM.
+    inline payload payload_from_memory( const void *data, uint16_t length)
+    {
+        const uint8_t *ptr = static_cast<const uint8_t *>( data);
+        return { length, [ptr]() mutable { return *ptr++;}};
+    }
+
+    /// Payload that consists of 'length' bytes in flash memory.
+    inline payload payload_P( const void *data, uint16_t length)
+    {
+        const uint8_t *ptr = static_cast<const uint8_t *>( data);
+        return { length, [ptr]() mutable
+            {
+                const uint8_t value = pgm_read_byte( ptr);
+                ++ptr;
+                return value;
+            }};
+    }
+
+    /**
+     * Payload that takes 'length' bytes from a ring buffer.
+     *
+     * The bytes are removed from the ring buffer while they are sent. If the
+     * ring buffer runs empty, the rest of the payload is filled with zeros.
+     */
+    template< uint8_t Size>
+    payload payload_from_queue( ring_buffer<Size> &queue, uint16_t length)
+    {
+        ring_buffer<Size> *source = &queue;
+        return { length, [source]
+            {
+                uint8_t value = 0;
+                source->pop( value);
+                return value;
+            }};
+    }
+}
+
+#endif /* ESP_LINK_PAYLOAD_HPP_ */
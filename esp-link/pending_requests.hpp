@@ -0,0 +1,181 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_PENDING_REQUESTS_HPP_
+#define ESP_LINK_PENDING_REQUESTS_HPP_
+#include "packet.hpp"
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * Table of requests that were sent to the esp-link and that still wait for a response.
+     *
+     * esp-link handles requests in the order in which they arrive, so a response
+     * belongs to the oldest request that is still waiting. The exception are requests
+     * for commands that echo the request value in their response (e.g. sync): those are
+     * only completed by a response that carries their value. The value of any other response
+     * is data (a time, a status), which can not be told apart from a request id.
+     *
+     * Requests that echo their value send echo_value( id), which has a fixed pattern in its upper
+     * 12 bits that small numbers and times before 2092 do not have. A response with such a value
+     * that no pending request waits for, e.g. a late or duplicate sync response, is ignored instead
+     * of being taken as the response to the oldest request.
+     *
+     * Every request carries a completion callback, which is called with the response packet,
+     * or with nullptr if the request failed or timed out.
+     */
+    template< uint8_t Capacity, typename Callback>
+    class pending_requests
+    {
+    public:
+        static constexpr uint32_t echo_mask     = 0xfff00000;
+        static constexpr uint32_t echo_pattern  = 0xe5c00000;
+
+        /// The value to send with a request with the given id, if its response echoes that value.
+        static constexpr uint32_t echo_value( uint32_t id)
+        {
+            return echo_pattern | (id & ~echo_mask);
+        }
+
+        /**
+         * Add a request to the table.
+         *
+         * value is the value that the request was sent with. deadline is the time (in milliseconds,
+         * as returned by the clock) at which the request will be completed as failed if no response
+         * has arrived. echoes_id must be true if the response to the request carries the value of
+         * the request, which must then be an echo_value().
+         * Returns false if the table is full.
+         */
+        bool add( uint32_t value, uint32_t deadline, const Callback &callback, bool echoes_id = false)
+        {
+            for (auto &entry : m_entries)
+            {
+                if (!entry.used)
+                {
+                    entry.value     = value;
+                    entry.order     = m_next_order++;
+                    entry.deadline  = deadline;
+                    entry.callback  = callback;
+                    entry.echoes_id = echoes_id;
+                    entry.used      = true;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Complete the request that the given response belongs to.
+         * Returns false if no request was waiting for the response.
+         */
+        bool complete( const packet *response)
+        {
+            entry *match = find_echo( response->value);
+            if (!match and (response->value & echo_mask) != echo_pattern) match = oldest();
+            if (!match) return false;
+
+            finish( *match, response);
+            return true;
+        }
+
+        /**
+         * Complete the oldest request as failed, to make room in the table if it is full.
+         * Requests that echo their value are left alone: their responses can not be mistaken
+         * for those of other requests, and a sync that is in flight is what the link depends on.
+         */
+        void expire_oldest()
+        {
+            if (entry *e = oldest()) finish( *e, nullptr);
+        }
+
+        /**
+         * Complete all requests whose deadline has passed at time 'now' as failed.
+         */
+        void expire( uint32_t now)
+        {
+            for (auto &entry : m_entries)
+            {
+                if (entry.used and static_cast<int32_t>( now - entry.deadline) >= 0)
+                {
+                    finish( entry, nullptr);
+                }
+            }
+        }
+
+        /// Complete all pending requests as failed.
+        void cancel_all()
+        {
+            for (auto &entry : m_entries)
+            {
+                if (entry.used) finish( entry, nullptr);
+            }
+        }
+
+        uint8_t size() const
+        {
+            uint8_t count = 0;
+            for (const auto &entry : m_entries)
+            {
+                if (entry.used) ++count;
+            }
+            return count;
+        }
+
+    private:
+        struct entry
+        {
+            uint32_t    value;
+            uint16_t    order;      ///< tells which of two requests was added first
+            uint32_t    deadline;
+            Callback    callback;
+            bool        echoes_id = false;
+            bool        used = false;
+        };
+
+        /// find the request with the given value, if its response echoes the value.
+        entry *find_echo( uint32_t value)
+        {
+            for (auto &entry : m_entries)
+            {
+                if (entry.used and entry.echoes_id and entry.value == value) return &entry;
+            }
+            return nullptr;
+        }
+
+        /// find the request that was added first, taking wrap-around of the order into account.
+        /// Requests that echo their value are not considered.
+        entry *oldest()
+        {
+            entry *result = nullptr;
+            for (auto &entry : m_entries)
+            {
+                if (entry.used and !entry.echoes_id
+                        and (!result or static_cast<int16_t>( entry.order - result->order) < 0))
+                {
+                    result = &entry;
+                }
+            }
+            return result;
+        }
+
+        /// remove an entry from the table and then call its callback. The entry is
+        /// removed first, so that the callback can safely send new requests.
+        static void finish( entry &e, const packet *response)
+        {
+            Callback callback = static_cast<Callback &&>( e.callback);
+            e.callback = Callback{};
+            e.used = false;
+            callback( response);
+        }
+
+        entry       m_entries[Capacity];
+        uint16_t    m_next_order = 0;
+    };
+}
+
+#endif /* ESP_LINK_PENDING_REQUESTS_HPP_ */
@@ -0,0 +1,583 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_PUBLISH_QUEUE_HPP_
+#define ESP_LINK_PUBLISH_QUEUE_HPP_
+#include "client.hpp"
+#include "command.hpp"
+#include "crc16.hpp"
+#include "eeprom_store.hpp"
+#include "span.hpp"
+#include "function/function.hpp"
+
+#include <avr/pgmspace.h>
+#include <avr_utilities/flash_string.hpp>
+#include <stdint.h>
+#include <string.h>
+
+namespace esp_link
+{
+    /**
+     * An MQTT message, as it is kept by a publish_queue: the topic, a terminating zero and the payload.
+     */
+    template< uint8_t DataSize>
+    struct queued_message
+    {
+        static constexpr uint8_t header_size = 3;
+
+        uint8_t topic_size;     ///< without the terminating zero
+        uint8_t payload_size;
+        uint8_t flags;          ///< qos in bits 0 and 1, retain in bit 2
+        char    data[DataSize];
+
+        const char *topic() const
+        {
+            return data;
+        }
+
+        span payload() const
+        {
+            return { data + topic_size + 1, payload_size};
+        }
+
+        /// number of bytes of this structure that are in use.
+        uint8_t size() const
+        {
+            return header_size + topic_size + 1 + payload_size;
+        }
+
+        bool has_topic( const char *other, uint8_t size) const
+        {
+            return size == topic_size and !memcmp( data, other, size);
+        }
+    };
+
+    /**
+     * Log of messages in a store (normally the EEPROM), oldest first.
+     *
+     * The store is divided into slots of one message each. Messages are always written to the slot
+     * after the one that was written last, going round, so that every slot gets written equally often,
+     * no matter which messages are removed. A message is never rewritten in its slot: a new message for
+     * the same topic goes to the next slot, which replaces the old message. When the log is full, a new
+     * message takes the slot of the oldest message only if that has been replaced, otherwise it is refused.
+     * Each slot starts with a 16-bit sequence number, a state byte and a crc of the sequence number and
+     * the message. That is enough to find the messages and the position to write at after a reset.
+     * The state byte of a new message is written last. A replaced message gets overwritten while its
+     * state stays pending, so that the state byte is not written twice for every message. A reset
+     * halfway shows up as a wrong crc.
+     */
+    template< typename Store, typename Message>
+    class message_log
+    {
+    public:
+        static constexpr uint8_t slot_header_size = 5;
+        static constexpr uint8_t slot_size = slot_header_size + sizeof( Message);
+        static constexpr uint8_t slots = Store::size / slot_size;
+
+        /**
+         * Find the messages that are in the store, e.g. after a reset.
+         */
+        void restore()
+        {
+            m_pending = 0;
+            m_write = 0;
+            m_sequence = 0;
+            bool found = false;
+            for (uint8_t slot = 0; slot < slots; ++slot)
+            {
+                uint8_t header[3];
+                Store::read( address( slot), header, sizeof header);
+                if (header[2] == state_erased) continue;
+
+                const uint16_t sequence = header[0] | (header[1] << 8);
+                if (header[2] == state_pending)
+                {
+                    if (intact( slot))
+                    {
+                        ++m_pending;
+                    }
+                    else
+                    {
+                        set_state( slot, state_done);
+                    }
+                }
+                if (not found or static_cast<int16_t>( sequence - m_sequence) >= 0)
+                {
+                    found = true;
+                    m_sequence = sequence;
+                    m_write = next( slot);
+                }
+            }
+            if (found) ++m_sequence;
+        }
+
+        /// number of messages in the log
+        uint8_t size() const
+        {
+            return m_pending;
+        }
+
+        /**
+         * Add a message to the end of the log.
+         *
+         * Returns false, without writing anything, if the log is full of messages that have not been
+         * replaced, or if there is no room for messages at all.
+         */
+        bool push( const Message &message)
+        {
+            if (!slots) return false;
+            const bool overwrite = state( m_write) == state_pending;
+            if (overwrite)
+            {
+                if (!replaced( m_write)) return false;
+                --m_pending;
+            }
+
+            const uint8_t sequence[2] = { static_cast<uint8_t>( m_sequence), static_cast<uint8_t>( m_sequence >> 8)};
+            uint16_t crc = 0;
+            crc = add( crc, sequence, sizeof sequence);
+            crc = add( crc, &message, message.size());
+            const uint8_t check[2] = { static_cast<uint8_t>( crc), static_cast<uint8_t>( crc >> 8)};
+
+            // the slot header is the sequence number, the state and the crc, in that order.
+            Store::write( address( m_write) + slot_header_size, &message, message.size());
+            Store::write( address( m_write), sequence, sizeof sequence);
+            Store::write( address( m_write) + 3, check, sizeof check);
+            if (!overwrite) set_state( m_write, state_pending);
+
+            ++m_pending;
+            ++m_sequence;
+            m_write = next( m_write);
+            return true;
+        }
+
+        /// Read the oldest message, returns false if the log is empty.
+        bool front( Message &message) const
+        {
+            const uint8_t slot = oldest();
+            if (slot == slots) return false;
+
+            read( slot, message);
+            return true;
+        }
+
+        /// Whether a newer message for the topic of the oldest message is in the log.
+        bool front_replaced() const
+        {
+            const uint8_t slot = oldest();
+            return slot != slots and replaced( slot);
+        }
+
+        /// Whether there is a message in the log with the given topic.
+        bool contains( const char *topic, uint8_t topic_size) const
+        {
+            for (uint8_t slot = 0; m_pending and slot < slots; ++slot)
+            {
+                if (state( slot) != state_pending or topic_size_of( slot) != topic_size) continue;
+
+                bool equal = true;
+                for (uint8_t index = 0; equal and index < topic_size; ++index)
+                {
+                    equal = topic_char( slot, index) == topic[index];
+                }
+                if (equal) return true;
+            }
+            return false;
+        }
+
+        /// Remove the oldest message.
+        void pop()
+        {
+            const uint8_t slot = oldest();
+            if (slot == slots) return;
+            set_state( slot, state_done);
+            --m_pending;
+        }
+
+    private:
+        static constexpr uint8_t state_erased  = 0xff;
+        static constexpr uint8_t state_pending = 0x5a;
+        static constexpr uint8_t state_done    = 0x00;
+
+        static uint16_t address( uint8_t slot)
+        {
+            return static_cast<uint16_t>( slot) * slot_size;
+        }
+
+        static uint8_t next( uint8_t slot)
+        {
+            return slot + 1 < slots ? slot + 1 : 0;
+        }
+
+        static uint8_t state( uint8_t slot)
+        {
+            uint8_t value;
+            Store::read( address( slot) + 2, &value, 1);
+            return value;
+        }
+
+        static void set_state( uint8_t slot, uint8_t value)
+        {
+            Store::write( address( slot) + 2, &value, 1);
+        }
+
+        /// Read the message in a slot, returns false if its sizes do not fit a message.
+        static bool read( uint8_t slot, Message &message)
+        {
+            // the header first, it tells how much of the message is in use.
+            Store::read( address( slot) + slot_header_size, &message, Message::header_size);
+            if (message.size() > sizeof message) return false;
+
+            Store::read( address( slot) + slot_header_size + Message::header_size,
+                    message.data, message.size() - Message::header_size);
+            return true;
+        }
+
+        static uint16_t add( uint16_t crc, const void *data, uint8_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>( data);
+            while (size--) crc = crc16::update( crc, *bytes++);
+            return crc;
+        }
+
+        /// Whether the crc of a slot matches its sequence number and message.
+        static bool intact( uint8_t slot)
+        {
+            uint8_t header[slot_header_size];
+            Store::read( address( slot), header, sizeof header);
+            Message message;
+            if (!read( slot, message)) return false;
+
+            const uint16_t crc = add( add( 0, header, 2), &message, message.size());
+            return crc == (header[3] | (header[4] << 8));
+        }
+
+        static uint8_t topic_size_of( uint8_t slot)
+        {
+            uint8_t size;
+            Store::read( address( slot) + slot_header_size, &size, 1);
+            return size;
+        }
+
+        static char topic_char( uint8_t slot, uint8_t index)
+        {
+            char c;
+            Store::read( address( slot) + slot_header_size + Message::header_size + index, &c, 1);
+            return c;
+        }
+
+        /**
+         * Whether the message in a slot has been replaced by a newer message for the same topic.
+         * The slots after it, up to the write position, hold the newer messages.
+         */
+        bool replaced( uint8_t slot) const
+        {
+            const uint8_t size = topic_size_of( slot);
+            for (uint8_t other = next( slot); other != m_write; other = next( other))
+            {
+                if (state( other) != state_pending or topic_size_of( other) != size) continue;
+
+                bool equal = true;
+                for (uint8_t index = 0; equal and index < size; ++index)
+                {
+                    equal = topic_char( other, index) == topic_char( slot, index);
+                }
+                if (equal) return true;
+            }
+            return false;
+        }
+
+        /// slot of the oldest message, or 'slots' if there is none. Slots are written
+        /// in order, so the oldest message is the first one after the last write.
+        uint8_t oldest() const
+        {
+            uint8_t slot = m_write;
+            for (uint8_t count = 0; m_pending and count < slots; ++count)
+            {
+                if (state( slot) == state_pending) return slot;
+                slot = next( slot);
+            }
+            return slots;
+        }
+
+        uint8_t     m_write = 0;        ///< slot to write the next message to
+        uint8_t     m_pending = 0;
+        uint16_t    m_sequence = 0;     ///< sequence number of the next message
+    };
+
+    /**
+     * Queue of MQTT messages in front of a client, for messages that are published while the link is down.
+     *
+     * While the link is up and nothing is queued, publish() sends messages directly. Otherwise messages
+     * are queued, with at most one message per topic that gets sent (last value wins). The queue holds
+     * RamSlots messages in RAM. When those are all in use, the oldest message moves to the Store, normally
+     * a region of EEPROM (@see eeprom_store). When that is full too, the oldest message in RAM is dropped.
+     * poll() sends the queued messages, oldest first, a burst at a time, once the link is up again.
+     *
+     * A new message for a topic that is queued in RAM replaces the old one, in its place in the queue.
+     * A new message for a topic that is in the Store is written to the next free slot of the Store
+     * instead of over the old message, so that the writes stay spread over the whole Store. poll()
+     * skips the old message.
+     *
+     * Messages of more than MessageSize bytes (topic, a terminating zero and payload) can only be sent
+     * directly. publish() drops them if the link is down.
+     *
+     * @code{.cpp}
+     * esp_link::publish_queue< esp_link::client, 4, 48, esp_link::eeprom_store<0, 512>> outbox( esp);
+     * ...
+     * outbox.restore();    // pick up messages that were in the EEPROM before a reset
+     * tasks.add_task( []{ outbox.poll();});
+     * ...
+     * outbox.publish( F_("/spider/temperature"), "21.5");
+     * @endcode
+     */
+    template< typename Client, uint8_t RamSlots = 4, uint8_t MessageSize = 48, typename Store = no_store>
+    class publish_queue
+    {
+    public:
+        static_assert( RamSlots > 0, "a publish queue needs at least one message in RAM");
+        static_assert( MessageSize <= 240, "messages in a publish queue can be at most 240 bytes");
+
+        using message = queued_message<MessageSize>;
+        using condition = function::function<bool ()>;
+
+        /// Number of messages that fit in the Store.
+        static constexpr uint8_t store_slots = message_log<Store, message>::slots;
+
+        explicit publish_queue( Client &client)
+        : m_client{ &client}
+        {
+        }
+
+        /// Find messages that were stored before a reset. This should be called once, at startup.
+        void restore()
+        {
+            m_log.restore();
+        }
+
+        /**
+         * Publish a message, or queue it if the link is down.
+         *
+         * Returns false if the message was dropped because it is too large to queue.
+         */
+        template< typename Topic>
+        bool publish( const Topic &topic, span payload, uint8_t qos = 0, uint8_t retain = 0)
+        {
+            if (online() and empty())
+            {
+                m_client->execute( mqtt::publish_binary, topic, payload, qos, retain);
+                return true;
+            }
+
+            message m;
+            if (!make_message( m, topic, payload, qos, retain))
+            {
+                ++m_dropped;
+                return false;
+            }
+            enqueue( m);
+            return true;
+        }
+
+        template< typename Topic>
+        bool publish( const Topic &topic, const char *payload, uint8_t qos = 0, uint8_t retain = 0)
+        {
+            return publish( topic, span( payload, strlen( payload)), qos, retain);
+        }
+
+        /**
+         * Send up to 'burst' queued messages, if the link is up.
+         *
+         * Call this regularly, e.g. as a scheduler task. Returns the number of messages sent.
+         */
+        uint8_t poll( uint8_t burst = 4)
+        {
+            uint8_t sent = 0;
+            while (sent < burst and online())
+            {
+                if (m_log.size())
+                {
+                    // skip messages that a newer message for the same topic replaces.
+                    message m;
+                    m_log.front( m);
+                    if (not m_log.front_replaced() and not queued( m.topic(), m.topic_size))
+                    {
+                        send( m);
+                        ++sent;
+                    }
+                    m_log.pop();
+                }
+                else if (m_count)
+                {
+                    send( m_messages[m_first]);
+                    pop_front();
+                    ++sent;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            return sent;
+        }
+
+        /**
+         * Set the condition under which messages are sent instead of queued, e.g. whether the
+         * esp-link is connected to the broker (@see connection_tracker). Without a condition,
+         * messages are sent whenever the link with the esp-link is up.
+         */
+        void send_when( condition online)
+        {
+            m_online = online;
+        }
+
+        /// Whether messages can be sent.
+        bool online()
+        {
+            return m_client->state() == link_state::up and (!m_online or m_online());
+        }
+
+        /// Number of queued messages.
+        uint16_t size() const
+        {
+            return m_count + m_log.size();
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /// Number of messages that replaced a queued message with the same topic.
+        uint16_t coalesced() const
+        {
+            return m_coalesced;
+        }
+
+        /// Number of messages that were written to the store, because RAM was full or
+        /// because the store held a message for the same topic.
+        uint16_t spilled() const
+        {
+            return m_spilled;
+        }
+
+        /// Number of messages that were too large, or that were dropped because the queue was full.
+        uint16_t dropped() const
+        {
+            return m_dropped;
+        }
+
+    private:
+        using log_type = message_log<Store, message>;
+
+        static uint8_t topic_size( const char *topic)
+        {
+            return strlen( topic);
+        }
+
+        static uint8_t topic_size( const flash_string::helper *topic)
+        {
+            return strlen_P( reinterpret_cast<const char *>( topic));
+        }
+
+        static void copy_topic( char *destination, const char *topic, uint8_t size)
+        {
+            memcpy( destination, topic, size);
+        }
+
+        static void copy_topic( char *destination, const flash_string::helper *topic, uint8_t size)
+        {
+            memcpy_P( destination, reinterpret_cast<const char *>( topic), size);
+        }
+
+        template< typename Topic>
+        static bool make_message( message &m, const Topic &topic, span payload, uint8_t qos, uint8_t retain)
+        {
+            const uint8_t size = topic_size( topic);
+            if (static_cast<uint16_t>( size) + 1 + payload.size > MessageSize) return false;
+
+            m.topic_size = size;
+            m.payload_size = payload.size;
+            m.flags = (qos & 3) | (retain ? 4 : 0);
+            copy_topic( m.data, topic, size);
+            m.data[size] = 0;
+            memcpy( m.data + size + 1, payload.data, payload.size);
+            return true;
+        }
+
+        void send( const message &m)
+        {
+            m_client->execute( mqtt::publish_binary, m.topic(), m.payload(), m.flags & 3, (m.flags >> 2) & 1);
+        }
+
+        /// The message in RAM with the given topic, or nullptr if there is none.
+        message *queued( const char *topic, uint8_t size)
+        {
+            for (uint8_t count = 0; count < m_count; ++count)
+            {
+                message &m = m_messages[position( count)];
+                if (m.has_topic( topic, size)) return &m;
+            }
+            return nullptr;
+        }
+
+        void enqueue( const message &m)
+        {
+            if (message *old = queued( m.topic(), m.topic_size))
+            {
+                *old = m;
+                ++m_coalesced;
+                return;
+            }
+
+            if (m_log.size() and m_log.contains( m.topic(), m.topic_size) and m_log.push( m))
+            {
+                ++m_coalesced;
+                ++m_spilled;
+                return;
+            }
+
+            if (m_count == RamSlots)
+            {
+                if (m_log.push( m_messages[m_first]))
+                {
+                    ++m_spilled;
+                }
+                else
+                {
+                    ++m_dropped;
+                }
+                pop_front();
+            }
+            m_messages[position( m_count)] = m;
+            ++m_count;
+        }
+
+        uint8_t position( uint8_t index) const
+        {
+            return (m_first + index) % RamSlots;
+        }
+
+        void pop_front()
+        {
+            m_first = position( 1);
+            --m_count;
+        }
+
+        Client      *m_client;
+        condition   m_online;
+        message     m_messages[RamSlots];
+        uint8_t     m_first = 0;
+        uint8_t     m_count = 0;
+        log_type    m_log;
+        uint16_t    m_coalesced = 0;
+        uint16_t    m_spilled = 0;
+        uint16_t    m_dropped = 0;
+    };
+}
+
+#endif /* ESP_LINK_PUBLISH_QUEUE_HPP_ */
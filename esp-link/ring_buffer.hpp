@@ -0,0 +1,78 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_RING_BUFFER_HPP_
+#define ESP_LINK_RING_BUFFER_HPP_
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * A byte queue with room for Size bytes.
+     *
+     * This queue is safe to use with one producer and one consumer, where
+     * one of the two may run in an interrupt handler: the producer only writes
+     * the head counter and the consumer only writes the tail counter and both
+     * are single bytes, so they are read and written atomically on an AVR.
+     *
+     * The counters run freely and are only masked when the buffer is indexed,
+     * which means that Size must be a power of two and at most 128.
+     */
+    template< uint8_t Size>
+    class ring_buffer
+    {
+    public:
+        static_assert( Size and (Size & (Size - 1)) == 0, "ring buffer size must be a power of two");
+        static_assert( Size <= 128, "ring buffer size must be at most 128");
+
+        static constexpr uint8_t capacity = Size;
+
+        /// add a byte to the queue, return false if the queue was full
+        bool push( uint8_t value)
+        {
+            const uint8_t head = m_head;
+            if (static_cast<uint8_t>( head - m_tail) == Size) return false;
+            m_data[head & mask] = value;
+            m_head = head + 1;
+            return true;
+        }
+
+        /// remove a byte from the queue, return false if the queue was empty
+        bool pop( uint8_t &value)
+        {
+            const uint8_t tail = m_tail;
+            if (tail == m_head) return false;
+            value = m_data[tail & mask];
+            m_tail = tail + 1;
+            return true;
+        }
+
+        uint8_t size() const
+        {
+            return m_head - m_tail;
+        }
+
+        uint8_t space() const
+        {
+            return Size - size();
+        }
+
+        bool empty() const
+        {
+            return m_head == m_tail;
+        }
+
+    private:
+        static constexpr uint8_t mask = Size - 1;
+
+        volatile uint8_t m_data[Size];
+        volatile uint8_t m_head = 0;
+        volatile uint8_t m_tail = 0;
+    };
+}
+
+#endif /* ESP_LINK_RING_BUFFER_HPP_ */
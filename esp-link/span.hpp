@@ -0,0 +1,52 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_SPAN_HPP_
+#define ESP_LINK_SPAN_HPP_
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * A sequence of bytes in RAM, given by a pointer and a size.
+     *
+     * This is the argument type for 'binary' parameters. Unlike strings, the bytes
+     * may contain zeros and their size does not need to be determined when sending.
+     */
+    struct span
+    {
+        span( const void *data, uint16_t size)
+        : data{ static_cast<const uint8_t *>( data)}, size{ size}
+        {
+        }
+
+        template< typename T, uint16_t Count>
+        span( const T (&array)[Count])
+        : data{ reinterpret_cast<const uint8_t *>( array)}, size{ sizeof array}
+        {
+        }
+
+        const uint8_t   *data;
+        uint16_t        size;
+    };
+
+    /**
+     * A sequence of bytes in flash memory, given by a pointer and a size.
+     */
+    struct span_P
+    {
+        span_P( const void *data, uint16_t size)
+        : data{ static_cast<const uint8_t *>( data)}, size{ size}
+        {
+        }
+
+        const uint8_t   *data;
+        uint16_t        size;
+    };
+}
+
+#endif /* ESP_LINK_SPAN_HPP_ */
@@ -0,0 +1,81 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_STATISTICS_HPP_
+#define ESP_LINK_STATISTICS_HPP_
+#include "command.hpp"
+#include "span.hpp"
+
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * Counters that describe how well the link with the esp-link behaves.
+     *
+     * All counters wrap around silently.
+     */
+    struct link_statistics
+    {
+        uint32_t bytes_received     = 0;    ///< bytes read from the uart, including SLIP framing
+        uint32_t bytes_sent         = 0;    ///< bytes written to the uart, including SLIP framing
+        uint16_t packets_received   = 0;    ///< frames with a correct crc
+        uint16_t crc_errors         = 0;    ///< frames with an incorrect crc
+        uint16_t dropped_frames     = 0;    ///< frames that did not fit, or for which there was no buffer
+        uint16_t unknown_callbacks  = 0;    ///< callback packets for unknown or stale handles
+        uint16_t syncs              = 0;    ///< synchronizations with the esp-link
+
+        /// size of the counters when serialized
+        static constexpr uint8_t serialized_size = 18;
+
+        /**
+         * Write all counters, in the order in which they are declared, as little-endian
+         * numbers into a buffer of serialized_size bytes.
+         */
+        void serialize( uint8_t *buffer) const
+        {
+            buffer = put( buffer, bytes_received);
+            buffer = put( buffer, bytes_sent);
+            buffer = put( buffer, packets_received);
+            buffer = put( buffer, crc_errors);
+            buffer = put( buffer, dropped_frames);
+            buffer = put( buffer, unknown_callbacks);
+            put( buffer, syncs);
+        }
+
+    private:
+        template< typename T>
+        static uint8_t *put( uint8_t *buffer, T value)
+        {
+            for (uint8_t count = sizeof value; count; --count)
+            {
+                *buffer++ = value;
+                value >>= 8;
+            }
+            return buffer;
+        }
+    };
+
+    /**
+     * Publish the link statistics of a client as one binary MQTT message of
+     * link_statistics::serialized_size bytes.
+     *
+     * To publish them periodically, call this from a timer:
+     * @code{.cpp}
+     * tasks.every( 60000, []{ esp_link::publish_statistics( esp, F_("/spider/link"));});
+     * @endcode
+     */
+    template< typename Client, typename Topic>
+    void publish_statistics( Client &client, const Topic &topic)
+    {
+        uint8_t buffer[link_statistics::serialized_size];
+        client.statistics().serialize( buffer);
+        client.execute( mqtt::publish_binary, topic, span( buffer), 0, 0);
+    }
+}
+
+#endif /* ESP_LINK_STATISTICS_HPP_ */
@@ -0,0 +1,192 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_STREAM_RECEIVER_HPP_
+#define ESP_LINK_STREAM_RECEIVER_HPP_
+#include "crc16.hpp"
+#include "packet.hpp"
+#include "function/function.hpp"
+
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * Callbacks for frames that are too large for a receive buffer.
+     *
+     * begin() is called with the header of such a frame and decides whether the frame
+     * should be streamed (return true) or dropped (return false). After that,
+     * the contents of the arguments are passed to data() in chunks, in order, together
+     * with the position of the argument that they belong to. The length fields and padding
+     * of arguments are not passed.
+     *
+     * Finally end() is called with true if the complete frame arrived with a correct crc, or with
+     * false otherwise. Because the crc can only be checked at the end, nothing that was
+     * passed to begin() or data() should be acted upon before end( true).
+     */
+    struct stream_handler
+    {
+        function::function<bool (const packet *header)>                              begin;
+        function::function<void (uint16_t argument, const uint8_t *data, uint8_t size)> data;
+        function::function<void (bool valid)>                                        end;
+    };
+
+    /**
+     * Receiver of frames that do not fit in a receive buffer.
+     *
+     * The receiver takes over a buffer that is filled with the first part of a frame and then
+     * uses that same buffer to collect chunks of argument data. This means that frames
+     * of any size can be received with a constant amount of memory.
+     */
+    class stream_receiver
+    {
+    public:
+        void set_handler( stream_handler *handler)
+        {
+            m_handler = handler;
+        }
+
+        bool active() const
+        {
+            return m_active;
+        }
+
+        /**
+         * Start streaming a frame.
+         *
+         * buffer contains the first 'size' bytes of the frame, crc is the
+         * crc of all those bytes except the last two.
+         * Returns false if there is no handler, or if the handler does not want this frame. In that case
+         * the buffer is left untouched.
+         */
+        bool start( uint8_t *buffer, uint8_t size, uint16_t crc)
+        {
+            if (!m_handler or size <= sizeof( packet) + 2) return false;
+
+            const packet *header = reinterpret_cast<const packet *>( buffer);
+            if (!m_handler->begin( header)) return false;
+
+            m_active    = true;
+            m_buffer    = buffer;
+            m_capacity  = size - sizeof( packet);
+            m_chunk     = 0;
+            m_argc      = header->argc;
+            m_argument  = 0;
+            m_state     = m_argc ? length_low : trailer;
+            m_crc       = crc;
+            m_window[0] = buffer[size - 2];
+            m_window[1] = buffer[size - 1];
+
+            // the argument data collected here never gets ahead of the bytes that
+            // are being parsed, so the buffer can be reused in place.
+            for (uint8_t index = sizeof( packet); index < size; ++index)
+            {
+                parse( buffer[index]);
+            }
+            return true;
+        }
+
+        /// Add the next byte of the frame.
+        void add( uint8_t value)
+        {
+            crc16::engine::add( m_window[0], m_crc);
+            m_window[0] = m_window[1];
+            m_window[1] = value;
+            parse( value);
+        }
+
+        /**
+         * End the frame. This checks the crc and tells the handler whether the
+         * frame was valid. Returns the same value as passed to the handler.
+         */
+        bool finish()
+        {
+            flush();
+            m_active = false;
+            const uint16_t received_crc = m_window[0] | (m_window[1] << 8);
+
+            // the crc may have been taken for padding, if the last argument was not padded.
+            const bool valid = (m_state == trailer or m_state == padding) and received_crc == m_crc;
+            m_handler->end( valid);
+            return valid;
+        }
+
+    private:
+        enum state : uint8_t { length_low, length_high, payload, padding, trailer};
+
+        uint8_t *chunk_begin() const
+        {
+            return m_buffer + sizeof( packet);
+        }
+
+        void parse( uint8_t value)
+        {
+            switch (m_state)
+            {
+            case length_low:
+                m_remaining = value;
+                m_state = length_high;
+                break;
+            case length_high:
+                m_remaining |= value << 8;
+                m_padding = (4 - (m_remaining & 3)) & 3;
+                if (m_remaining) m_state = payload;
+                else next_argument();
+                break;
+            case payload:
+                chunk_begin()[m_chunk++] = value;
+                if (!--m_remaining)
+                {
+                    flush();
+                    if (m_padding) m_state = padding;
+                    else next_argument();
+                }
+                else if (m_chunk == m_capacity)
+                {
+                    flush();
+                }
+                break;
+            case padding:
+                if (!--m_padding) next_argument();
+                break;
+            case trailer:
+                // only the crc is left.
+                break;
+            }
+        }
+
+        void next_argument()
+        {
+            m_state = ++m_argument < m_argc ? length_low : trailer;
+        }
+
+        /// pass the data that was collected to the handler.
+        void flush()
+        {
+            if (m_chunk)
+            {
+                m_handler->data( m_argument, chunk_begin(), m_chunk);
+                m_chunk = 0;
+            }
+        }
+
+        stream_handler  *m_handler = nullptr;
+        uint8_t         *m_buffer = nullptr;
+        uint8_t         m_capacity = 0;     ///< room for argument data in the buffer
+        uint8_t         m_chunk = 0;        ///< number of bytes of argument data in the buffer
+        uint16_t        m_argc = 0;
+        uint16_t        m_argument = 0;     ///< argument that is being received
+        uint16_t        m_remaining = 0;    ///< bytes of argument data that are still to come
+        uint8_t         m_padding = 0;      ///< bytes of padding that are still to come
+        state           m_state = length_low;
+        uint16_t        m_crc = 0;          ///< crc of everything except the last two bytes
+        uint8_t         m_window[2] = {};   ///< the last two bytes received
+        bool            m_active = false;
+    };
+}
+
+#endif /* ESP_LINK_STREAM_RECEIVER_HPP_ */
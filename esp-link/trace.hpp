@@ -0,0 +1,62 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_TRACE_HPP_
+#define ESP_LINK_TRACE_HPP_
+#include "command.hpp"
+#include "payload.hpp"
+#include "trace/trace.hpp"
+
+#include <stdint.h>
+
+namespace esp_link
+{
+    /**
+     * Ids of the trace events of the esp-link client.
+     *
+     * Ids below 32 are reserved for the client, applications can use the others.
+     * @see trace/trace.hpp
+     */
+    namespace trace_events
+    {
+        enum : uint8_t
+        {
+            sync            = 1,    ///< info:  client starts to synchronize, value is 0
+            packet          = 2,    ///< debug: valid packet received, value is the command
+            crc_error       = 3,    ///< error: frame with a wrong crc, value is the frame size
+            frame_dropped   = 4,    ///< error: frame too large or no receive buffer free, value is 0
+            unknown_callback= 5,    ///< info:  callback packet for an unknown or stale handle, value is the lower 16 bits of the handle
+        };
+    }
+
+    /**
+     * Publish the contents of the trace buffer as a binary MQTT message.
+     *
+     * Every event is sent as 5 bytes: time (16 bits), value (16 bits) and id (8 bits), with all
+     * numbers little-endian, oldest event first. The events are read from the trace buffer while the
+     * message is sent, no copy is made.
+     */
+    template< typename Client, typename Topic>
+    void publish_trace( Client &client, const Topic &topic)
+    {
+        using ::trace::event;
+        uint16_t position = 0;
+        client.execute( mqtt::publish, topic,
+            payload{
+                static_cast<uint16_t>( ::trace::size() * event::serialized_size),
+                [position]() mutable
+                {
+                    const uint8_t value = ::trace::at( position / event::serialized_size)
+                            .serialized( position % event::serialized_size);
+                    ++position;
+                    return value;
+                }},
+            0, 0);
+    }
+}
+
+#endif /* ESP_LINK_TRACE_HPP_ */
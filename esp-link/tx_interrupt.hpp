@@ -0,0 +1,85 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ESP_LINK_TX_INTERRUPT_HPP_
+#define ESP_LINK_TX_INTERRUPT_HPP_
+
+/**
+ * This file contains the hardware side of the buffered transmit mode of the
+ * esp-link client (ESP_LINK_TX_BUFFER_SIZE > 0).
+ *
+ * In that mode, the client puts all outgoing bytes in a queue and the
+ * USART data register empty (UDRE) interrupt moves them from that queue to the
+ * USART. The interrupt handler is enabled whenever a byte is queued and disables
+ * itself when the queue runs empty.
+ *
+ * The interrupt handler itself is created with IMPLEMENT_ESP_LINK_TX_INTERRUPT(),
+ * which must appear exactly once in the firmware:
+ *
+ * @code{.cpp}
+ * esp_link::client esp( uart);
+ * IMPLEMENT_ESP_LINK_TX_INTERRUPT( esp);
+ * @endcode
+ *
+ * Note that this can not be combined with a uart implementation that uses the
+ * UDRE interrupt itself.
+ */
+#ifdef __AVR__
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace esp_link
+{
+namespace tx_interrupt
+{
+    inline void enable()
+    {
+        UCSR0B |= _BV( UDRIE0);
+    }
+
+    inline void disable()
+    {
+        UCSR0B &= ~_BV( UDRIE0);
+    }
+}
+}
+
+#if ESP_LINK_TX_BUFFER_SIZE
+#define IMPLEMENT_ESP_LINK_TX_INTERRUPT( client_)       \
+ISR( USART_UDRE_vect)                                   \
+{                                                       \
+    uint8_t value;                                      \
+    if (client_.next_tx_byte( value))                   \
+    {                                                   \
+        UDR0 = value;                                   \
+    }                                                   \
+    else                                                \
+    {                                                   \
+        esp_link::tx_interrupt::disable();              \
+    }                                                   \
+}
+#else
+#define IMPLEMENT_ESP_LINK_TX_INTERRUPT( client_)
+#endif
+
+#else // not __AVR__
+
+// On the host there is no interrupt, host code drains the queue explicitly
+// through client::next_tx_byte().
+namespace esp_link
+{
+namespace tx_interrupt
+{
+    inline void enable() {}
+    inline void disable() {}
+}
+}
+#define IMPLEMENT_ESP_LINK_TX_INTERRUPT( client_)
+
+#endif // __AVR__
+
+#endif /* ESP_LINK_TX_INTERRUPT_HPP_ */
@@ -10,6 +10,8 @@
  */
 #ifndef FUNCTION_FUNCTION_HPP_
 #define FUNCTION_FUNCTION_HPP_
+#include <stddef.h>
+#include <stdint.h>
 
 namespace function
 {
@@ -34,48 +36,175 @@ namespace function
     {
     };
 
+    template< typename T>
+    struct remove_reference
+    {
+        typedef T type;
+    };
+
+    template< typename T>
+    struct remove_reference<T &>
+    {
+        typedef T type;
+    };
+
+    template< typename T>
+    struct remove_reference<T &&>
+    {
+        typedef T type;
+    };
+
     // simplified implementation of forward, I'll always remember to explicitly
     // specify the template type, I promise.
     template< typename T>
-    T&& forward( T && val)
+    T&& forward( typename remove_reference<T>::type &val)
     {
         return static_cast<T&&>(val);
     }
 
-    template<typename T>
+    template< bool Condition, typename T = void>
+    struct enable_if
+    {
+    };
+
+    template< typename T>
+    struct enable_if<true, T>
+    {
+        typedef T type;
+    };
+
+    template< typename T, typename U>
+    struct is_same
+    {
+        static constexpr bool value = false;
+    };
+
+    template< typename T>
+    struct is_same<T, T>
+    {
+        static constexpr bool value = true;
+    };
+
+    namespace detail
+    {
+        /// tag for our own placement new, avr-libc has no <new>
+        struct placement {};
+    }
+}
+
+inline void *operator new( size_t, function::detail::placement, void *where)
+{
+    return where;
+}
+
+inline void operator delete( void *, function::detail::placement, void *)
+{
+}
+
+namespace function
+{
+    /**
+     * Callable object, much like std::function<>.
+     *
+     * A function can hold one of:
+     *  - a free function,
+     *  - an object pointer together with a member function pointer,
+     *  - a function object (e.g. a capturing lambda) of at most Capacity bytes, which is stored
+     *    inside the function itself. Function objects that are too large are rejected at
+     *    compile time. The default capacity is the size of two pointers, which is
+     *    enough for a lambda that captures one or two pointers or references.
+     *  - nothing. Calling an empty function does nothing and returns a default-constructed value.
+     *
+     * This never allocates memory on the heap.
+     */
+    template< typename T, uint8_t Capacity = 2 * sizeof( void *)>
     class function{};
 
-    template< typename ReturnType, typename... Args>
-    class function< ReturnType (Args...)>
+    template< typename ReturnType, typename... Args, uint8_t Capacity>
+    class function< ReturnType (Args...), Capacity>
     {
     public:
 
         /// construct a function object with a free function
         function( ReturnType (*f)(Args...))
-        :m_object{nullptr}, m_f{ f}
-        {}
+        :m_object{nullptr}, m_ops{ nullptr}
+        {
+            m_u.f = f ? f : &noop;
+        }
 
         /// construct a functin object with a member function and
         /// an object pointer.
         template<typename ObjectType>
         function( ObjectType *object, ReturnType (ObjectType::*mf)(Args...))
-        :m_object{ reinterpret_cast<PlaceHolder *>(object)},
-         m_mf{ reinterpret_cast<MemberFunction>( mf)}
+        :m_object{ reinterpret_cast<PlaceHolder *>(object)}, m_ops{ nullptr}
         {
+            m_u.mf = reinterpret_cast<MemberFunction>( mf);
         }
 
-        function()
-        :m_object{nullptr}, m_f{ nullptr}
+        /// construct a function object with a copy of a function object (functor, lambda)
+        template<typename Functor, typename = typename enable_if< !is_same<Functor, function>::value>::type>
+        function( Functor f)
+        :m_object{ nullptr}, m_ops{ &functor_ops<Functor>::ops}
+        {
+            static_assert( sizeof( Functor) <= Capacity, "function object too large for the inline storage of this function type");
+            static_assert( alignof( Functor) <= alignof( storage), "function object has stricter alignment than this function type supports");
+            new (detail::placement{}, m_u.bytes) Functor( static_cast<Functor &&>( f));
+        }
+
+        function( decltype( nullptr))
+        :function{}
         {}
 
+        function()
+        :m_object{nullptr}, m_ops{ nullptr}
+        {
+            m_u.f = &noop;
+        }
+
+        function( const function &other)
+        {
+            copy_from( other);
+        }
+
+        function( function &&other)
+        {
+            move_from( other);
+        }
+
+        function &operator=( const function &other)
+        {
+            if (this != &other)
+            {
+                destroy();
+                copy_from( other);
+            }
+            return *this;
+        }
+
+        function &operator=( function &&other)
+        {
+            if (this != &other)
+            {
+                destroy();
+                move_from( other);
+            }
+            return *this;
+        }
+
+        ~function()
+        {
+            destroy();
+        }
 
         /// function call operator for non-void function types
         template<typename RT = ReturnType, typename... Arguments>
         typename if_not_void<RT>::type operator()( Arguments&&... args)
         {
             return m_object ?
-                    (m_object->*m_mf)( forward<Arguments>(args)...)
-                    :m_f(forward<Arguments>(args)...);
+                    (m_object->*m_u.mf)( forward<Arguments>(args)...)
+                    : m_ops ?
+                            m_ops->invoke( m_u.bytes, forward<Arguments>(args)...)
+                            :m_u.f(forward<Arguments>(args)...);
         }
 
         /// function call operator for void function types
@@ -84,17 +213,21 @@ namespace function
         {
             if (m_object)
             {
-                    (m_object->*m_mf)(forward<Arguments>(args)...);
+                    (m_object->*m_u.mf)(forward<Arguments>(args)...);
+            }
+            else if (m_ops)
+            {
+                    m_ops->invoke( m_u.bytes, forward<Arguments>(args)...);
             }
             else
             {
-                    m_f(forward<Arguments>(args)...);
+                    m_u.f(forward<Arguments>(args)...);
             }
         }
 
         explicit operator bool() const
         {
-            return m_object != nullptr || m_f != nullptr;
+            return m_object != nullptr || m_ops != nullptr || m_u.f != &noop;
         }
 
     private:
@@ -103,11 +236,102 @@ namespace function
         using MemberFunction = ReturnType (PlaceHolder::*)( Args...);
         using FreeFunction = ReturnType (*)( Args...);
 
-        PlaceHolder *m_object;
-        union {
-            FreeFunction m_f;
-            MemberFunction m_mf;
+        /// what an empty function calls
+        static ReturnType noop( Args...)
+        {
+            return ReturnType();
+        }
+
+        /// type-specific operations on a stored function object
+        struct operations
+        {
+            ReturnType  (*invoke)(  void *object, Args... args);
+            void        (*copy)(    void *to, const void *from);
+            void        (*move)(    void *to, void *from);
+            void        (*destroy)( void *object);
         };
+
+        template< typename Functor>
+        struct functor_ops
+        {
+            static ReturnType invoke( void *object, Args... args)
+            {
+                return (*static_cast<Functor *>( object))( forward<Args>( args)...);
+            }
+
+            static void copy( void *to, const void *from)
+            {
+                new (detail::placement{}, to) Functor( *static_cast<const Functor *>( from));
+            }
+
+            static void move( void *to, void *from)
+            {
+                new (detail::placement{}, to) Functor( static_cast<Functor &&>( *static_cast<Functor *>( from)));
+            }
+
+            static void destroy( void *object)
+            {
+                static_cast<Functor *>( object)->~Functor();
+            }
+
+            static const operations ops;
+        };
+
+        void copy_from( const function &other)
+        {
+            m_object = other.m_object;
+            m_ops    = other.m_ops;
+            if (m_ops)
+            {
+                m_ops->copy( m_u.bytes, other.m_u.bytes);
+            }
+            else
+            {
+                m_u = other.m_u;
+            }
+        }
+
+        void move_from( function &other)
+        {
+            m_object = other.m_object;
+            m_ops    = other.m_ops;
+            if (m_ops)
+            {
+                m_ops->move( m_u.bytes, other.m_u.bytes);
+            }
+            else
+            {
+                m_u = other.m_u;
+            }
+        }
+
+        void destroy()
+        {
+            if (m_ops)
+            {
+                m_ops->destroy( m_u.bytes);
+                m_ops = nullptr;
+                m_u.f = &noop;
+            }
+        }
+
+        union storage
+        {
+            FreeFunction    f;
+            MemberFunction  mf;
+            unsigned char   bytes[Capacity];
+        };
+
+        PlaceHolder         *m_object;
+        const operations    *m_ops;
+        storage             m_u;
+    };
+
+    template< typename ReturnType, typename... Args, uint8_t Capacity>
+    template< typename Functor>
+    const typename function< ReturnType (Args...), Capacity>::operations
+        function< ReturnType (Args...), Capacity>::functor_ops<Functor>::ops = {
+            &invoke, &copy, &move, &destroy
     };
 }
 
@@ -0,0 +1,149 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of esp_link::argument_list and esp_link::argument on well-formed and malformed packets.
+ */
+#include "esp-link/arguments.hpp"
+#include "check.hpp"
+
+#include <string.h>
+
+namespace
+{
+    /// Received packet bytes, aligned the way the client stores them.
+    class received
+    {
+    public:
+        explicit received( const std::vector<uint8_t> &raw)
+        : m_words( raw.size() / 4 + 1), m_size( raw.size())
+        {
+            memcpy( m_words.data(), raw.data(), raw.size());
+        }
+
+        esp_link::argument_list arguments( uint16_t size) const
+        {
+            return { reinterpret_cast<const esp_link::packet *>( m_words.data()), size};
+        }
+
+        esp_link::argument_list arguments() const
+        {
+            return arguments( m_size);
+        }
+
+    private:
+        std::vector<uint32_t>   m_words;
+        uint16_t                m_size;
+    };
+
+    std::string le( uint32_t value, uint8_t size)
+    {
+        std::vector<uint8_t> bytes;
+        check::append_le( bytes, value, size);
+        return { bytes.begin(), bytes.end()};
+    }
+
+    void check_well_formed()
+    {
+        const received p{ check::raw_packet( 10, 0, { "abc", le( 0x12345678, 4), le( 0xbeef, 2), ""})};
+        const auto args = p.arguments();
+        CHECK( args.size() == 4);
+        CHECK( args.complete());
+        CHECK( args[0].size == 3 and memcmp( args[0].chars(), "abc", 3) == 0);
+        CHECK( args[1].as<uint32_t>() == 0x12345678);
+        CHECK( args[2].as<uint16_t>() == 0xbeef);
+        CHECK( args[3] and args[3].size == 0);
+
+        uint16_t count = 0;
+        for (const auto &arg : args) count += arg ? 1 : 0;
+        CHECK( count == 4);
+    }
+
+    void check_out_of_range()
+    {
+        const received p{ check::raw_packet( 10, 0, { "abc", le( 7, 4)})};
+        const auto args = p.arguments();
+        CHECK( not args[2]);
+        CHECK( args[2].size == 0 and args[2].data == nullptr);
+        CHECK( not args[0xffff]);
+        CHECK( args[2].as<uint32_t>( 99) == 99);
+
+        uint32_t value = 5;
+        CHECK( not args[2].get( value) and value == 5);
+
+        const esp_link::argument_list none{ nullptr, 0};
+        CHECK( none.size() == 0 and not none.complete() and not none[0]);
+    }
+
+    /// An argument whose length goes beyond the end of the packet, or a header that announces more arguments than there are.
+    void check_truncated()
+    {
+        // header (8 bytes), first argument (2 + 4 bytes), second length at offset 14, second data at 16.
+        auto raw = check::raw_packet( 10, 0, { "abcd", "efgh"});
+
+        // the second argument claims 10 bytes, but only 4 were received.
+        auto too_long = raw;
+        too_long[8 + 6] = 10;
+        const received long_argument{ too_long};
+        CHECK( long_argument.arguments().size() == 1);
+        CHECK( not long_argument.arguments().complete());
+        CHECK( not long_argument.arguments()[1]);
+        CHECK( long_argument.arguments()[0].size == 4);
+
+        // a length of 0xffff must not wrap around.
+        auto huge = raw;
+        huge[8 + 6] = 0xff;
+        huge[8 + 7] = 0xff;
+        const received huge_argument{ huge};
+        CHECK( huge_argument.arguments().size() == 1 and not huge_argument.arguments()[1]);
+
+        // the packet ends in the middle of the second length field, or in the middle of the data.
+        const received p{ raw};
+        CHECK( p.arguments( 8 + 6 + 1).size() == 1);
+        CHECK( p.arguments( 8 + 6 + 2 + 3).size() == 1);
+        CHECK( p.arguments( 8 + 6 + 2 + 4).size() == 2);
+
+        // the last argument needs no padding at the end of the packet.
+        CHECK( check::raw_packet( 10, 0, { "abcde"}).size() == 8 + 2 + 8);
+        const received unpadded{ check::raw_packet( 10, 0, { "abcde"})};
+        CHECK( unpadded.arguments( 8 + 2 + 5).complete());
+
+        // more arguments announced than present.
+        auto extra = raw;
+        extra[2] = 3;
+        const received announced{ extra};
+        CHECK( announced.arguments().size() == 2 and not announced.arguments().complete());
+
+        // not even a complete header.
+        CHECK( p.arguments( 4).size() == 0 and not p.arguments( 4).complete());
+    }
+
+    void check_wrong_size()
+    {
+        const received p{ check::raw_packet( 10, 0, { le( 0x1234, 2), le( 0x12345678, 4), "x"})};
+        const auto args = p.arguments();
+        CHECK( args[0].as<uint32_t>( 1) == 1);
+        CHECK( args[0].as<uint8_t>( 2) == 2);
+        CHECK( args[1].as<uint16_t>( 3) == 3);
+        CHECK( args[1].as<uint64_t>( 4) == 4);
+        CHECK( args[2].as<uint8_t>() == 'x');
+        CHECK( args[2].as<uint16_t>() == 0);
+
+        uint16_t value = 5;
+        CHECK( not args[1].get( value) and value == 5);
+        CHECK( args[0].get( value) and value == 0x1234);
+    }
+}
+
+int main()
+{
+    check_well_formed();
+    check_out_of_range();
+    check_truncated();
+    check_wrong_size();
+    return check::result( "argument_check");
+}
@@ -0,0 +1,108 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks, in simulated time, of the exponential backoff between sync attempts when the
+ * esp-link does not respond.
+ */
+#include "esp-link/client.hpp"
+#include "check.hpp"
+
+#include <avr_utilities/devices/uart.h>
+
+#include <vector>
+
+#ifndef TIMING_FAKE_CLOCK
+#error "backoff_check must be built with the fake clock"
+#endif
+
+namespace
+{
+    using esp_link::link_state;
+    using timing::fake_clock;
+
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    /// Poll the client every millisecond until it is no longer in the given state and return the time (ms).
+    uint32_t poll_while( link_state state)
+    {
+        for (uint32_t count = 0; count < 100000 and esp.state() == state; ++count)
+        {
+            fake_clock::advance_ms( 1);
+            esp.release( esp.try_receive());
+        }
+        return fake_clock::now_ms();
+    }
+
+    /// Drop the response to the current sync request and return the time (ms) at which the next one starts.
+    uint32_t drop_sync()
+    {
+        const uint32_t sent = fake_clock::now_ms();
+        const uint32_t failed = poll_while( link_state::syncing);
+        CHECK( esp.state() == link_state::backoff);
+        CHECK( failed - sent == esp_link::client::request_timeout_ms);
+
+        const uint32_t retried = poll_while( link_state::backoff);
+        CHECK( esp.state() == link_state::syncing);
+        return retried - failed;
+    }
+
+    void answer_sync()
+    {
+        uart.feed( check::esp_frame( esp_link::commands::CMD_RESP_V, check::last_request_value( uart)));
+        while (uart.data_available()) esp.release( esp.try_receive());
+        CHECK( esp.state() == link_state::up);
+    }
+
+    /// The delay doubles from sync_retry_min_ms with every failed attempt, up to sync_retry_max_ms.
+    void check_sequence()
+    {
+        fake_clock::set_us( 1000000);
+        esp.reset_statistics();
+        esp.connect();
+
+        const std::vector<uint32_t> expected{ 250, 500, 1000, 2000, 4000, 8000, 16000, 16000, 16000};
+        std::vector<uint32_t> delays;
+        for (size_t attempt = 0; attempt < expected.size(); ++attempt) delays.push_back( drop_sync());
+        CHECK( delays == expected);
+        CHECK( esp.statistics().syncs == expected.size() + 1);
+
+        answer_sync();
+    }
+
+    /// A successful sync starts the next series of failures at the minimum delay again.
+    void check_reset()
+    {
+        // the esp-link restarts and then stops responding.
+        uart.feed( check::esp_frame( esp_link::commands::CMD_SYNC, 0));
+        while (uart.data_available()) esp.release( esp.try_receive());
+        CHECK( esp.state() == link_state::syncing);
+
+        CHECK( drop_sync() == esp_link::client::sync_retry_min_ms);
+        CHECK( drop_sync() == 2 * esp_link::client::sync_retry_min_ms);
+        CHECK( drop_sync() == 4 * esp_link::client::sync_retry_min_ms);
+        answer_sync();
+
+        uart.feed( check::esp_frame( esp_link::commands::CMD_SYNC, 0));
+        while (uart.data_available()) esp.release( esp.try_receive());
+        CHECK( drop_sync() == esp_link::client::sync_retry_min_ms);
+
+        // connect() also starts again at the minimum delay.
+        CHECK( drop_sync() == 2 * esp_link::client::sync_retry_min_ms);
+        esp.connect();
+        CHECK( drop_sync() == esp_link::client::sync_retry_min_ms);
+        answer_sync();
+    }
+}
+
+int main()
+{
+    check_sequence();
+    check_reset();
+    return check::result( "backoff_check");
+}
@@ -0,0 +1,217 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Host throughput benchmark for the esp-link client.
+ *
+ * This runs the client against the in-memory uart and reports how many frames
+ * and bytes per second the SLIP/CRC encoder (execute()) and decoder (try_receive())
+ * can handle. The numbers are only meaningful relative to each other, as a baseline
+ * for changes to the encoding and decoding paths.
+ */
+#include "esp-link/client.hpp"
+#include <avr_utilities/devices/uart.h>
+#include <avr_utilities/flash_string.hpp>
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    struct result
+    {
+        const char *name;
+        uint32_t    frames;
+        uint64_t    bytes;
+        double      seconds;
+    };
+
+    void report( const result &r)
+    {
+        printf( "%-28s %10u frames %12.0f frames/s %14.0f bytes/s\n",
+                r.name,
+                r.frames,
+                r.frames / r.seconds,
+                r.bytes / r.seconds);
+    }
+
+    /// In buffered transmit mode, do what the transmit interrupt
+    /// would do on the device: move the queued bytes to the uart.
+    void drain_tx_queue()
+    {
+        uint8_t value;
+        while (esp.next_tx_byte( value)) uart.send( value);
+    }
+
+    double seconds_since( bench_clock::time_point start)
+    {
+        return std::chrono::duration<double>( bench_clock::now() - start).count();
+    }
+
+    /// Time a number of calls to execute(), as performed by the given function.
+    template< typename Function>
+    result bench_encode( const char *name, uint32_t frames, Function f)
+    {
+        uint64_t bytes = 0;
+        uart.clear_transmitted();
+        const auto start = bench_clock::now();
+        for (uint32_t count = 0; count < frames; ++count)
+        {
+            f();
+            drain_tx_queue();
+            bytes += uart.transmitted().size();
+            uart.clear_transmitted();
+        }
+        return { name, frames, bytes, seconds_since( start)};
+    }
+
+    /// Time decoding of the given frame, fed to try_receive() in batches.
+    result bench_decode( const char *name, uint32_t frames, const std::vector<uint8_t> &frame)
+    {
+        constexpr uint32_t batch_size = 1000;
+        std::vector<uint8_t> batch;
+        for (uint32_t count = 0; count < batch_size; ++count)
+        {
+            batch.insert( batch.end(), frame.begin(), frame.end());
+        }
+
+        uint32_t decoded = 0;
+        double seconds = 0;
+        for (uint32_t batches = frames / batch_size; batches; --batches)
+        {
+            uart.feed( batch);
+            const auto start = bench_clock::now();
+            while (uart.data_available())
+            {
+                if (auto p = esp.try_receive())
+                {
+                    ++decoded;
+                    esp.release( p);
+                }
+            }
+            seconds += seconds_since( start);
+            uart.clear_transmitted();
+        }
+
+        if (decoded != frames)
+        {
+            fprintf( stderr, "%s: decoded %u out of %u frames\n", name, decoded, frames);
+        }
+        return { name, decoded, static_cast<uint64_t>( decoded) * frame.size(), seconds};
+    }
+
+    /**
+     * Feed the given frame to the client one byte at a time, as the uart would, and measure
+     * how long every single call to try_receive() takes.
+     *
+     * This reports the average and worst case time of calls that complete a frame
+     * separately from all other calls, to show how much work is concentrated at
+     * the end of a frame.
+     */
+    void bench_receive_latency( const char *name, uint32_t frames, const std::vector<uint8_t> &frame)
+    {
+        using std::chrono::nanoseconds;
+        using std::chrono::duration_cast;
+
+        uint64_t byte_calls = 0;
+        uint64_t byte_total = 0;
+        uint64_t byte_max   = 0;
+        uint64_t end_total  = 0;
+        uint64_t end_max    = 0;
+        uint32_t decoded    = 0;
+
+        for (uint32_t count = 0; count < frames; ++count)
+        {
+            for (auto value : frame)
+            {
+                uart.feed( &value, 1);
+                const auto start = bench_clock::now();
+                auto p = esp.try_receive();
+                const uint64_t ns = duration_cast<nanoseconds>( bench_clock::now() - start).count();
+                if (p)
+                {
+                    ++decoded;
+                    end_total += ns;
+                    if (ns > end_max) end_max = ns;
+                    esp.release( p);
+                }
+                else
+                {
+                    ++byte_calls;
+                    byte_total += ns;
+                    if (ns > byte_max) byte_max = ns;
+                }
+            }
+            uart.clear_transmitted();
+        }
+
+        printf( "%-28s %10u frames   per byte: %6.1f ns avg %8u ns max   end of frame: %6.1f ns avg %8u ns max\n",
+                name,
+                decoded,
+                byte_calls ? double( byte_total) / byte_calls : 0.0,
+                static_cast<unsigned>( byte_max),
+                decoded ? double( end_total) / decoded : 0.0,
+                static_cast<unsigned>( end_max));
+    }
+
+    /// Capture the bytes that the client sends for a single command.
+    template< typename Function>
+    std::vector<uint8_t> capture( Function f)
+    {
+        uart.clear_transmitted();
+        f();
+        drain_tx_queue();
+        auto frame = uart.transmitted();
+        uart.clear_transmitted();
+        return frame;
+    }
+}
+
+int main()
+{
+    using esp_link::mqtt::publish;
+    using esp_link::mqtt::subscribe;
+
+    constexpr uint32_t frames = 200000;
+
+    printf( "transmit queue: %u bytes\n", ESP_LINK_TX_BUFFER_SIZE);
+
+    auto publish_short = []{ esp.execute( publish, "/spider/temp", "21.5", 0, 0);};
+    auto publish_long  = []{ esp.execute( publish, "/spider/status/hub",
+            "{\"pir\":0,\"led\":1,\"uptime\":123456,\"rssi\":-67}", 1, 0);};
+    auto publish_streamed = []{ esp.execute( publish, "/spider/status/hub", esp_link::payload_from_memory(
+            "{\"pir\":0,\"led\":1,\"uptime\":123456,\"rssi\":-67}", 44), 1, 0);};
+    auto subscribe_ram   = []{ esp.execute( subscribe, "/spider/LED", 0);};
+    auto subscribe_flash = []{ esp.execute( subscribe, F_("/spider/LED"), 0);};
+    auto subscribe_frame = []{ esp.send_frame(
+            esp_link::make_frame( subscribe, ESP_LINK_STRING( "/spider/LED"), esp_link::constant<0>{}));};
+
+    report( bench_encode( "encode publish (short)",     frames, publish_short));
+    report( bench_encode( "encode publish (long)",      frames, publish_long));
+    report( bench_encode( "encode publish (streamed)",  frames, publish_streamed));
+    report( bench_encode( "encode subscribe (ram)",     frames, subscribe_ram));
+    report( bench_encode( "encode subscribe (flash)",   frames, subscribe_flash));
+    report( bench_encode( "encode subscribe (frame)",   frames, subscribe_frame));
+
+    // the client does not care what command a packet holds, as long as it is
+    // neither a sync nor a callback, so the requests it sends itself make
+    // good test material for the decoder.
+    report( bench_decode( "decode publish (short)",     frames, capture( publish_short)));
+    report( bench_decode( "decode publish (long)",      frames, capture( publish_long)));
+    report( bench_decode( "decode subscribe",           frames, capture( subscribe_ram)));
+
+    bench_receive_latency( "receive latency (short)",   frames / 10, capture( publish_short));
+    bench_receive_latency( "receive latency (long)",    frames / 10, capture( publish_long));
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Capture files of serial traffic.
+ *
+ * A capture file is a text file with one byte per line:
+ *
+ *     <time in microseconds> <rx|tx> <value in hex>
+ *
+ * Times only need to be non-decreasing, they are relative to an arbitrary start. Empty lines and
+ * lines starting with '#' are ignored. capture::ring::print() writes the same format,
+ * so a capture that was taken on the device can be replayed as well.
+ */
+#ifndef HOST_CAPTURE_FILE_HPP_
+#define HOST_CAPTURE_FILE_HPP_
+#include "capture/capture.hpp"
+#include "timing/clock.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace capture
+{
+    /**
+     * Recorder that writes every byte to a capture file.
+     *
+     * A recorder without an open file records nothing.
+     */
+    class capture_file
+    {
+    public:
+        explicit capture_file( const char *path = nullptr)
+        {
+            if (path) open( path);
+        }
+
+        ~capture_file()
+        {
+            close();
+        }
+
+        /// Start writing to a new capture file, returns false if the file can not be created.
+        bool open( const char *path)
+        {
+            close();
+            m_file = fopen( path, "w");
+            m_started = false;
+            m_time = 0;
+            return m_file != nullptr;
+        }
+
+        void close()
+        {
+            if (m_file) fclose( m_file);
+            m_file = nullptr;
+        }
+
+        capture_file( const capture_file &) = delete;
+        capture_file &operator=( const capture_file &) = delete;
+
+        explicit operator bool() const
+        {
+            return m_file != nullptr;
+        }
+
+        void record( direction dir, uint8_t value)
+        {
+            if (!m_file) return;
+
+            // keep a 64-bit time, the 32-bit microsecond clock wraps after 71 minutes.
+            const uint32_t now = timing::clock::now_us();
+            if (m_started) m_time += static_cast<uint32_t>( now - m_last_us);
+            m_started = true;
+            m_last_us = now;
+
+            fprintf( m_file, "%llu %s %02x\n",
+                    static_cast<unsigned long long>( m_time), dir == direction::rx ? "rx" : "tx", value);
+        }
+
+    private:
+        FILE        *m_file = nullptr;
+        uint64_t    m_time = 0;
+        uint32_t    m_last_us = 0;
+        bool        m_started = false;
+    };
+
+    /// A byte of a capture, as read from a capture file.
+    struct captured_byte
+    {
+        uint64_t    time;   ///< microseconds
+        direction   dir;
+        uint8_t     value;
+    };
+
+    /**
+     * Read a capture file.
+     *
+     * Returns false if the file can not be opened or contains a line that
+     * is not in capture format. In the latter case, line is set to the offending line number.
+     */
+    inline bool read_capture_file( const char *path, std::vector<captured_byte> &bytes, unsigned &line)
+    {
+        FILE *file = fopen( path, "r");
+        line = 0;
+        if (!file) return false;
+
+        char text[80];
+        bool ok = true;
+        while (ok and fgets( text, sizeof text, file))
+        {
+            ++line;
+            if (text[0] == '#')
+            {
+                // skip the rest of a long comment.
+                while (!strchr( text, '\n') and fgets( text, sizeof text, file)) {}
+                continue;
+            }
+            if (text[0] == '\n' or text[0] == '\r') continue;
+
+            unsigned long long time;
+            char dir[3];
+            unsigned value;
+            ok = sscanf( text, "%llu %2s %x", &time, dir, &value) == 3
+                    and value <= 0xff
+                    and (!strcmp( dir, "rx") or !strcmp( dir, "tx"));
+            if (ok)
+            {
+                bytes.push_back( { time, dir[0] == 'r' ? direction::rx : direction::tx, static_cast<uint8_t>( value)});
+            }
+        }
+
+        fclose( file);
+        return ok;
+    }
+}
+
+#endif /* HOST_CAPTURE_FILE_HPP_ */
@@ -0,0 +1,164 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Support for the host check programs, which 'make check' runs.
+ *
+ * CHECK( condition) reports a condition that does not hold, with its location, and carries on.
+ * A check program returns check::result() from main(), which is nonzero if any check failed.
+ *
+ * The header also encodes frames the way the esp-link sends them, to feed into the client.
+ */
+#ifndef HOST_CHECK_HPP_
+#define HOST_CHECK_HPP_
+#include "esp-link/client.hpp"
+
+#include <avr_utilities/devices/uart.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define CHECK( condition) \
+    ((condition) ? check::pass() : check::fail( __FILE__, __LINE__, #condition))
+
+namespace check
+{
+    struct counts
+    {
+        unsigned checks     = 0;
+        unsigned failures   = 0;
+    };
+
+    inline counts &totals()
+    {
+        static counts instance;
+        return instance;
+    }
+
+    inline void pass()
+    {
+        ++totals().checks;
+    }
+
+    inline void fail( const char *file, int line, const char *expression)
+    {
+        ++totals().checks;
+        ++totals().failures;
+        fprintf( stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+
+    /// Print a summary and return the exit code of a check program.
+    inline int result( const char *name)
+    {
+        printf( "%s: %u checks, %u failed\n", name, totals().checks, totals().failures);
+        return totals().failures ? 1 : 0;
+    }
+
+    inline void append_le( std::vector<uint8_t> &raw, uint32_t value, uint8_t size)
+    {
+        while (size--)
+        {
+            raw.push_back( value);
+            value >>= 8;
+        }
+    }
+
+    /**
+     * Append the crc to the raw bytes of a packet and SLIP-encode the result, as the esp-link would send it.
+     * If corrupt is set, the crc of the frame is wrong.
+     */
+    inline std::vector<uint8_t> slip_frame( std::vector<uint8_t> raw, bool corrupt = false)
+    {
+        uint16_t crc = 0;
+        for (auto byte : raw) crc = esp_link::crc16::update( crc, byte);
+        append_le( raw, corrupt ? crc ^ 0x0101 : crc, 2);
+
+        std::vector<uint8_t> frame{ esp_link::detail::SLIP_END};
+        for (auto byte : raw)
+        {
+            if (byte == esp_link::detail::SLIP_END)
+            {
+                frame.push_back( esp_link::detail::SLIP_ESC);
+                frame.push_back( esp_link::detail::SLIP_ESC_END);
+            }
+            else if (byte == esp_link::detail::SLIP_ESC)
+            {
+                frame.push_back( esp_link::detail::SLIP_ESC);
+                frame.push_back( esp_link::detail::SLIP_ESC_ESC);
+            }
+            else
+            {
+                frame.push_back( byte);
+            }
+        }
+        frame.push_back( esp_link::detail::SLIP_END);
+        return frame;
+    }
+
+    /// The raw bytes of a packet with the given header and arguments, without crc.
+    inline std::vector<uint8_t> raw_packet( uint16_t cmd, uint32_t value, const std::vector<std::string> &arguments = {})
+    {
+        std::vector<uint8_t> raw;
+        append_le( raw, cmd, 2);
+        append_le( raw, arguments.size(), 2);
+        append_le( raw, value, 4);
+        for (const auto &argument : arguments)
+        {
+            append_le( raw, argument.size(), 2);
+            raw.insert( raw.end(), argument.begin(), argument.end());
+            for (size_t pad = (4 - (argument.size() & 3)) & 3; pad; --pad) raw.push_back( 0);
+        }
+        return raw;
+    }
+
+    /**
+     * The value in the header of the last request that the client sent over the mock uart.
+     * This also clears the bytes that were transmitted.
+     */
+    inline uint32_t last_request_value( serial::uart<> &uart)
+    {
+        std::vector<uint8_t> raw;
+        std::vector<uint8_t> last;
+        bool escaped = false;
+        for (auto byte : uart.transmitted())
+        {
+            if (byte == esp_link::detail::SLIP_END)
+            {
+                if (raw.size() >= 8) last = raw;
+                raw.clear();
+            }
+            else if (byte == esp_link::detail::SLIP_ESC)
+            {
+                escaped = true;
+            }
+            else
+            {
+                if (escaped) byte = byte == esp_link::detail::SLIP_ESC_END ? esp_link::detail::SLIP_END : esp_link::detail::SLIP_ESC;
+                escaped = false;
+                raw.push_back( byte);
+            }
+        }
+        uart.clear_transmitted();
+        return last.size() >= 8 ? last[4] | (last[5] << 8) | (last[6] << 16) | (uint32_t( last[7]) << 24) : 0;
+    }
+
+    /**
+     * SLIP-encode a frame with the given header and arguments, as the esp-link would send it.
+     * If corrupt is set, the crc of the frame is wrong.
+     */
+    inline std::vector<uint8_t> esp_frame(
+            uint16_t cmd, uint32_t value,
+            const std::vector<std::string> &arguments = {},
+            bool corrupt = false)
+    {
+        return slip_frame( raw_packet( cmd, value, arguments), corrupt);
+    }
+}
+
+#endif /* HOST_CHECK_HPP_ */
@@ -0,0 +1,153 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of how the esp-link client receives frames, run against the in-memory uart.
+ */
+#include "esp-link/client.hpp"
+#include "check.hpp"
+
+#include <avr_utilities/devices/uart.h>
+
+#include <vector>
+
+namespace
+{
+    using check::esp_frame;
+
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    /// Feed bytes to the client and return the packet that they complete, if any.
+    const esp_link::packet *receive( const std::vector<uint8_t> &bytes)
+    {
+        uart.feed( bytes);
+        const esp_link::packet *result = nullptr;
+        while (uart.data_available() and not result) result = esp.try_receive();
+        return result;
+    }
+
+    uint32_t last_request_value()
+    {
+        return check::last_request_value( uart);
+    }
+
+    /// Synchronize with the client and return the value of the sync request.
+    uint32_t connect()
+    {
+        uart.clear_transmitted();
+        esp.connect();
+        const uint32_t sync_value = last_request_value();
+        esp.release( receive( esp_frame( esp_link::commands::CMD_RESP_V, sync_value)));
+        CHECK( esp.state() == esp_link::link_state::up);
+        return sync_value;
+    }
+
+    /**
+     * Responses that carry data are matched with requests in order, even if their value
+     * happens to be the id of another pending request.
+     */
+    void check_response_order()
+    {
+        using esp_link::commands::CMD_RESP_V;
+
+        connect();
+        uint32_t time = 0;
+        uint8_t status = 0;
+        esp.execute_async( esp_link::get_time, [&]( bool ok, uint32_t value){ if (ok) time = value;});
+        esp.execute_async( esp_link::get_wifi_status, [&]( bool ok, uint8_t value){ if (ok) status = value;});
+        const uint32_t wifi_id = last_request_value();
+
+        esp.release( receive( esp_frame( CMD_RESP_V, wifi_id)));
+        esp.release( receive( esp_frame( CMD_RESP_V, 5)));
+        CHECK( time == wifi_id);
+        CHECK( status == 5);
+        CHECK( esp.pending_requests() == 0);
+    }
+
+    /**
+     * A late or duplicate sync response completes no other request, and does not
+     * complete a newer sync either.
+     */
+    void check_stray_sync_response()
+    {
+        using esp_link::commands::CMD_RESP_V;
+
+        const uint32_t sync_value = connect();
+        bool done = false;
+        uint32_t time = 0;
+        esp.execute_async( esp_link::get_time, [&]( bool ok, uint32_t value){ done = true; if (ok) time = value;});
+
+        esp.release( receive( esp_frame( CMD_RESP_V, sync_value)));
+        CHECK( not done);
+        CHECK( esp.state() == esp_link::link_state::up);
+        esp.release( receive( esp_frame( CMD_RESP_V, 1500000000)));
+        CHECK( done and time == 1500000000);
+
+        uart.clear_transmitted();
+        esp.connect();
+        const uint32_t next_sync_value = last_request_value();
+        esp.release( receive( esp_frame( CMD_RESP_V, sync_value)));
+        CHECK( esp.state() == esp_link::link_state::syncing);
+        esp.release( receive( esp_frame( CMD_RESP_V, next_sync_value)));
+        CHECK( esp.state() == esp_link::link_state::up);
+    }
+
+    /// Requests that do not fit in the table of pending requests do not push out a sync that is in flight.
+    void check_full_table_keeps_sync()
+    {
+        uart.clear_transmitted();
+        esp.connect();
+        const uint32_t sync_value = last_request_value();
+        for (uint8_t count = 0; count < ESP_LINK_PENDING_REQUESTS + 2; ++count) esp.execute( esp_link::get_time);
+        CHECK( esp.state() == esp_link::link_state::syncing);
+        CHECK( esp.pending_requests() == ESP_LINK_PENDING_REQUESTS);
+
+        esp.release( receive( esp_frame( esp_link::commands::CMD_RESP_V, sync_value)));
+        CHECK( esp.state() == esp_link::link_state::up);
+    }
+
+    /**
+     * A frame that starts while all receive slots are taken is dropped as a whole,
+     * even if a slot is released before the frame ends.
+     */
+    void check_no_slot_at_frame_start()
+    {
+        esp.reset_statistics();
+        std::vector<const esp_link::packet *> held;
+        for (uint8_t slot = 0; slot < ESP_LINK_RX_SLOTS; ++slot)
+        {
+            held.push_back( receive( esp_frame( 100, slot)));
+            CHECK( held.back() != nullptr);
+        }
+
+        const auto frame = esp_frame( 100, 42, { "/spider/LED", "1"});
+        const std::vector<uint8_t> head( frame.begin(), frame.begin() + frame.size() / 2);
+        const std::vector<uint8_t> tail( frame.begin() + frame.size() / 2, frame.end());
+
+        CHECK( receive( head) == nullptr);
+        esp.release( held.front());
+        CHECK( receive( tail) == nullptr);
+        CHECK( esp.statistics().dropped_frames == 1);
+        CHECK( esp.statistics().crc_errors == 0);
+
+        // the next frame gets the released slot.
+        const auto p = receive( esp_frame( 100, 43));
+        CHECK( p and p->value == 43);
+        esp.release( p);
+        for (size_t index = 1; index < held.size(); ++index) esp.release( held[index]);
+    }
+}
+
+int main()
+{
+    check_response_order();
+    check_stray_sync_response();
+    check_full_table_keeps_sync();
+    check_no_slot_at_frame_start();
+    return check::result( "client_check");
+}
@@ -0,0 +1,77 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Benchmark of the crc16 engines.
+ *
+ * This times all engines over a set of random buffers. crc_check, which 'make check' runs,
+ * checks that they compute the right crc.
+ */
+#include "esp-link/crc16.hpp"
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+    using namespace esp_link;
+
+    template< typename Engine>
+    uint16_t crc_of( const std::vector<uint8_t> &buffer)
+    {
+        uint16_t crc = 0;
+        for (auto value : buffer)
+        {
+            Engine::add( value, crc);
+        }
+        return crc;
+    }
+
+    template< typename Engine>
+    void bench( const char *name, const std::vector< std::vector<uint8_t>> &buffers)
+    {
+        using bench_clock = std::chrono::steady_clock;
+        constexpr int rounds = 200;
+
+        uint64_t bytes = 0;
+        uint16_t sink  = 0;
+        const auto start = bench_clock::now();
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (const auto &buffer : buffers)
+            {
+                sink += crc_of<Engine>( buffer);
+                bytes += buffer.size();
+            }
+        }
+        const double seconds = std::chrono::duration<double>( bench_clock::now() - start).count();
+        printf( "%-10s %14.0f bytes/s (0x%04x)\n", name, bytes / seconds, sink);
+    }
+}
+
+int main()
+{
+    std::mt19937 generator{ 42};
+    std::uniform_int_distribution<int> byte_value{ 0, 255};
+    std::uniform_int_distribution<int> buffer_size{ 0, 300};
+
+    std::vector< std::vector<uint8_t>> buffers;
+    for (int count = 0; count < 10000; ++count)
+    {
+        std::vector<uint8_t> buffer( buffer_size( generator));
+        for (auto &value : buffer) value = static_cast<uint8_t>( byte_value( generator));
+        buffers.push_back( buffer);
+    }
+
+    bench<crc16::bitwise>( "bitwise", buffers);
+    bench<crc16::table>(   "table",   buffers);
+    bench<crc16::nibble>(  "nibble",  buffers);
+
+    return 0;
+}
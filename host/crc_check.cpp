@@ -0,0 +1,67 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of the crc16 engines: the standard check value of CRC-16/KERMIT, and agreement of the
+ * table and nibble engines with the bitwise engine on random buffers.
+ */
+#include "esp-link/crc16.hpp"
+#include "check.hpp"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    using namespace esp_link;
+
+    template< typename Engine>
+    uint16_t crc_of( const std::vector<uint8_t> &buffer)
+    {
+        uint16_t crc = 0;
+        for (auto value : buffer)
+        {
+            Engine::add( value, crc);
+        }
+        return crc;
+    }
+
+    template< typename Engine>
+    bool agrees( const std::vector< std::vector<uint8_t>> &buffers)
+    {
+        for (const auto &buffer : buffers)
+        {
+            if (crc_of<Engine>( buffer) != crc_of<crc16::bitwise>( buffer)) return false;
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    const std::vector<uint8_t> digits{ '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    CHECK( crc_of<crc16::bitwise>( digits) == 0x2189);
+    CHECK( crc_of<crc16::table>( digits) == 0x2189);
+    CHECK( crc_of<crc16::nibble>( digits) == 0x2189);
+    CHECK( crc_of<crc16::engine>( digits) == 0x2189);
+
+    std::mt19937 generator{ 42};
+    std::uniform_int_distribution<int> byte_value{ 0, 255};
+    std::uniform_int_distribution<int> buffer_size{ 0, 300};
+
+    std::vector< std::vector<uint8_t>> buffers{ {}, { 0}, { 0xff}};
+    for (int count = 0; count < 10000; ++count)
+    {
+        std::vector<uint8_t> buffer( buffer_size( generator));
+        for (auto &value : buffer) value = static_cast<uint8_t>( byte_value( generator));
+        buffers.push_back( buffer);
+    }
+    CHECK( agrees<crc16::table>( buffers));
+    CHECK( agrees<crc16::nibble>( buffers));
+
+    return check::result( "crc_check");
+}
@@ -0,0 +1,372 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "esp_link_emulator.hpp"
+
+#include "esp-link/arguments.hpp"
+#include "esp-link/command_codes.hpp"
+#include "esp-link/crc16.hpp"
+#include "timing/clock.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint8_t SLIP_END     = 0xC0;
+    constexpr uint8_t SLIP_ESC     = 0xDB;
+    constexpr uint8_t SLIP_ESC_END = 0xDC;
+    constexpr uint8_t SLIP_ESC_ESC = 0xDD;
+
+    template< typename T>
+    void append_le( std::vector<uint8_t> &buffer, T value)
+    {
+        for (size_t count = 0; count < sizeof value; ++count)
+        {
+            buffer.push_back( static_cast<uint8_t>( value >> (8 * count)));
+        }
+    }
+
+    uint16_t crc_of( const uint8_t *data, size_t size)
+    {
+        uint16_t crc = 0;
+        while (size--) crc = esp_link::crc16::update( crc, *data++);
+        return crc;
+    }
+
+    std::string to_string( const esp_link::argument &arg)
+    {
+        return arg ? std::string( arg.chars(), arg.size) : std::string{};
+    }
+}
+
+namespace emulator
+{
+    void broker::subscribe( const std::string &filter)
+    {
+        for (const auto &existing : m_filters)
+        {
+            if (existing == filter) return;
+        }
+        m_filters.push_back( filter);
+    }
+
+    void broker::clear()
+    {
+        m_filters.clear();
+    }
+
+    bool broker::subscribed( const std::string &topic) const
+    {
+        for (const auto &filter : m_filters)
+        {
+            if (matches( filter, topic)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Match a topic against a filter. '+' matches exactly one topic level, '#' at the
+     * end of a filter matches any number of levels.
+     */
+    bool broker::matches( const std::string &filter, const std::string &topic)
+    {
+        size_t f = 0;
+        size_t t = 0;
+        while (f < filter.size())
+        {
+            if (filter[f] == '#') return true;
+            if (filter[f] == '+')
+            {
+                while (t < topic.size() and topic[t] != '/') ++t;
+                ++f;
+                continue;
+            }
+            if (t >= topic.size() or filter[f] != topic[t]) return false;
+            ++f;
+            ++t;
+        }
+        return t == topic.size();
+    }
+
+    esp_link_emulator::esp_link_emulator( serial::uart<> &uart, link_conditions conditions, uint32_t seed)
+    : m_uart( uart), m_conditions( conditions), m_random( seed), m_last_clock( timing::clock::now_us())
+    {
+    }
+
+    /// current time in microseconds, as a 64-bit number that does not wrap around.
+    uint64_t esp_link_emulator::now()
+    {
+        const uint32_t clock = timing::clock::now_us();
+        m_time += static_cast<uint32_t>( clock - m_last_clock);
+        m_last_clock = clock;
+        return m_time;
+    }
+
+    void esp_link_emulator::poll()
+    {
+        for (auto value : m_uart.transmitted())
+        {
+            enqueue( m_to_emulator, value);
+        }
+        m_uart.clear_transmitted();
+
+        uint8_t value;
+        while (deliver( m_to_emulator, value))
+        {
+            receive( value);
+        }
+
+        while (deliver( m_to_client, value))
+        {
+            m_uart.feed( &value, 1);
+        }
+    }
+
+    bool esp_link_emulator::idle() const
+    {
+        return m_to_emulator.bytes.empty() and m_to_client.bytes.empty() and m_uart.transmitted().empty();
+    }
+
+    /// put a byte on the line, it arrives one byte time after the previous byte.
+    void esp_link_emulator::enqueue( line &l, uint8_t value)
+    {
+        const uint64_t time = now();
+        const uint64_t byte_time = m_conditions.baudrate ? 10000000ULL / m_conditions.baudrate : 0;
+        l.busy_until = (l.busy_until > time ? l.busy_until : time) + byte_time;
+        l.bytes.push_back( { l.busy_until, value});
+    }
+
+    /// take the next byte that has arrived, applying loss and corruption.
+    bool esp_link_emulator::deliver( line &l, uint8_t &value)
+    {
+        std::uniform_real_distribution<double> chance( 0.0, 1.0);
+        const uint64_t time = now();
+        while (not l.bytes.empty() and l.bytes.front().time <= time)
+        {
+            value = l.bytes.front().value;
+            l.bytes.pop_front();
+
+            if (m_conditions.loss_rate > 0 and chance( m_random) < m_conditions.loss_rate)
+            {
+                ++m_counters.bytes_lost;
+                continue;
+            }
+            if (m_conditions.corruption_rate > 0 and chance( m_random) < m_conditions.corruption_rate)
+            {
+                ++m_counters.bytes_corrupted;
+                value ^= 1 << (m_random() % 8);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /// SLIP-decode a byte from the client.
+    void esp_link_emulator::receive( uint8_t value)
+    {
+        if (value == SLIP_END)
+        {
+            if (not m_frame.empty()) handle_frame( m_frame);
+            m_frame.clear();
+            m_escaped = false;
+        }
+        else if (value == SLIP_ESC)
+        {
+            m_escaped = true;
+        }
+        else
+        {
+            if (m_escaped)
+            {
+                if (value == SLIP_ESC_END) value = SLIP_END;
+                else if (value == SLIP_ESC_ESC) value = SLIP_ESC;
+                m_escaped = false;
+            }
+            m_frame.push_back( value);
+        }
+    }
+
+    void esp_link_emulator::handle_frame( const std::vector<uint8_t> &frame)
+    {
+        using namespace esp_link::commands;
+
+        // header and crc at least. Shorter frames are noise between frames, like the
+        // bare SLIP_END that the client sends before a sync.
+        if (frame.size() < 10) return;
+
+        const size_t size = frame.size() - 2;
+        if (crc_of( frame.data(), size) != (frame[size] | (frame[size + 1] << 8)))
+        {
+            ++m_counters.crc_errors;
+            return;
+        }
+        ++m_counters.frames_received;
+
+        // copy to aligned memory, so that the packet header can be read directly.
+        std::vector<uint32_t> aligned( (size + 3) / 4);
+        std::copy( frame.begin(), frame.begin() + size, reinterpret_cast<uint8_t *>( aligned.data()));
+        const auto *p = reinterpret_cast<const esp_link::packet *>( aligned.data());
+        const esp_link::argument_list args( p, size);
+
+        switch (p->cmd)
+        {
+        case CMD_SYNC:
+            m_synced = true;
+            forget_callbacks();
+            send_frame( CMD_RESP_V, p->value);
+            break;
+
+        case CMD_WIFI_STATUS:
+            send_frame( CMD_RESP_V, m_wifi_status);
+            break;
+
+        case CMD_CB_ADD:
+            // the only named callback that the esp-link knows.
+            if (to_string( args[0]) == "wifiCb") m_wifi_callback = p->value;
+            break;
+
+        case CMD_CB_EVENTS:
+            send_wifi_status();
+            break;
+
+        case CMD_GET_TIME:
+            send_frame( CMD_RESP_V, m_epoch_seconds + static_cast<uint32_t>( now() / 1000000));
+            break;
+
+        case CMD_MQTT_SETUP:
+            // connected, disconnected, published, data
+            m_connected_callback    = args[0].as<uint32_t>();
+            m_disconnected_callback = args[1].as<uint32_t>();
+            m_data_callback         = args[3].as<uint32_t>();
+
+            if (m_broker_connected and m_connected_callback) send_frame( CMD_RESP_CB, m_connected_callback);
+            break;
+
+        case CMD_MQTT_SUBSCRIBE:
+            m_broker.subscribe( to_string( args[0]));
+            break;
+
+        case CMD_MQTT_PUBLISH:
+        {
+            if (!m_broker_connected)
+            {
+                ++m_counters.publishes_lost;
+                break;
+            }
+
+            // like the esp-link, publish as many bytes of the payload as the length argument says.
+            const std::string payload = to_string( args[1]).substr( 0, args[2].as<uint16_t>());
+            message m{ to_string( args[0]), payload, args[3].as<uint8_t>(), args[4].as<uint8_t>()};
+            m_published.push_back( m);
+            deliver_message( m.topic, m.payload);
+            break;
+        }
+
+        default:
+            // commands that are not emulated get no response.
+            break;
+        }
+    }
+
+    /// encode a frame with the given header and arguments and put it on the line to the client.
+    void esp_link_emulator::send_frame( uint16_t cmd, uint32_t value, const std::vector<std::string> &arguments)
+    {
+        std::vector<uint8_t> raw;
+        append_le( raw, cmd);
+        append_le( raw, static_cast<uint16_t>( arguments.size()));
+        append_le( raw, value);
+        for (const auto &arg : arguments)
+        {
+            append_le( raw, static_cast<uint16_t>( arg.size()));
+            raw.insert( raw.end(), arg.begin(), arg.end());
+            for (size_t pad = (4 - (arg.size() & 3)) & 3; pad; --pad) raw.push_back( 0);
+        }
+        append_le( raw, crc_of( raw.data(), raw.size()));
+
+        enqueue( m_to_client, SLIP_END);
+        for (auto byte : raw)
+        {
+            if (byte == SLIP_END)
+            {
+                enqueue( m_to_client, SLIP_ESC);
+                enqueue( m_to_client, SLIP_ESC_END);
+            }
+            else if (byte == SLIP_ESC)
+            {
+                enqueue( m_to_client, SLIP_ESC);
+                enqueue( m_to_client, SLIP_ESC_ESC);
+            }
+            else
+            {
+                enqueue( m_to_client, byte);
+            }
+        }
+        enqueue( m_to_client, SLIP_END);
+        ++m_counters.frames_sent;
+    }
+
+    void esp_link_emulator::deliver_message( const std::string &topic, const std::string &payload)
+    {
+        if (m_data_callback and m_broker.subscribed( topic))
+        {
+            send_frame( esp_link::commands::CMD_RESP_CB, m_data_callback, { topic, payload});
+        }
+    }
+
+    void esp_link_emulator::send_wifi_status()
+    {
+        if (m_wifi_callback)
+        {
+            send_frame( esp_link::commands::CMD_RESP_CB, m_wifi_callback, { std::string( 1, static_cast<char>( m_wifi_status))});
+        }
+    }
+
+    void esp_link_emulator::forget_callbacks()
+    {
+        m_connected_callback = 0;
+        m_disconnected_callback = 0;
+        m_data_callback = 0;
+        m_wifi_callback = 0;
+        m_broker.clear();
+    }
+
+    void esp_link_emulator::restart()
+    {
+        m_synced = false;
+        forget_callbacks();
+        send_frame( esp_link::commands::CMD_SYNC, 0);
+    }
+
+    void esp_link_emulator::set_broker_connected( bool connected)
+    {
+        if (connected == m_broker_connected) return;
+        m_broker_connected = connected;
+
+        // a new broker session starts without subscriptions.
+        if (!connected) m_broker.clear();
+
+        const uint32_t callback = connected ? m_connected_callback : m_disconnected_callback;
+        if (callback) send_frame( esp_link::commands::CMD_RESP_CB, callback);
+    }
+
+    void esp_link_emulator::set_wifi_status( uint8_t status)
+    {
+        m_wifi_status = status;
+        send_wifi_status();
+        if (status != wifi_got_ip) set_broker_connected( false);
+    }
+
+    void esp_link_emulator::publish( const std::string &topic, const std::string &payload)
+    {
+        deliver_message( topic, payload);
+    }
+
+    void esp_link_emulator::set_time( uint32_t seconds)
+    {
+        m_epoch_seconds = seconds - static_cast<uint32_t>( now() / 1000000);
+    }
+}
@@ -0,0 +1,193 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Host emulation of the esp-link side of the serial protocol.
+ *
+ * The emulator reads what the client writes to the mock uart, answers the commands
+ * that the client uses (sync, get time, wifi status, MQTT setup, subscribe and publish) and
+ * delivers MQTT messages through a small in-memory broker. The connection with the broker
+ * and the wifi status can be changed, to see how the client copes with an unreachable broker.
+ *
+ * Between the client and the emulator sits a simulated serial line, which delivers bytes
+ * no faster than the configured baud rate allows and which can lose or corrupt bytes.
+ * Time is taken from timing::clock, so with TIMING_FAKE_CLOCK the complete
+ * simulation is deterministic.
+ */
+#ifndef HOST_ESP_LINK_EMULATOR_HPP_
+#define HOST_ESP_LINK_EMULATOR_HPP_
+#include <avr_utilities/devices/uart.h>
+
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace emulator
+{
+    /**
+     * Properties of the serial line between the client and the emulator. These apply to both directions.
+     */
+    struct link_conditions
+    {
+        uint32_t    baudrate        = 19200;    ///< 0 means bytes arrive instantly
+        double      loss_rate       = 0;        ///< probability that a byte gets lost
+        double      corruption_rate = 0;        ///< probability that a byte arrives with a flipped bit
+    };
+
+    /**
+     * A minimal MQTT broker: a set of topic filters, with the usual '+' and '#' wildcards.
+     */
+    class broker
+    {
+    public:
+        void subscribe( const std::string &filter);
+        void clear();
+        bool subscribed( const std::string &topic) const;
+
+        static bool matches( const std::string &filter, const std::string &topic);
+
+    private:
+        std::vector<std::string> m_filters;
+    };
+
+    /// An MQTT message that the client published.
+    struct message
+    {
+        std::string topic;
+        std::string payload;
+        uint8_t     qos;
+        uint8_t     retain;
+    };
+
+    struct counters
+    {
+        uint32_t frames_received    = 0;    ///< valid frames from the client
+        uint32_t crc_errors         = 0;    ///< frames from the client with a wrong crc
+        uint32_t frames_sent        = 0;    ///< frames sent to the client
+        uint32_t bytes_lost         = 0;    ///< in either direction
+        uint32_t bytes_corrupted    = 0;    ///< in either direction
+        uint32_t publishes_lost     = 0;    ///< messages published while the broker was unreachable
+    };
+
+    /// wifi status that means the esp-link is connected to an access point.
+    constexpr uint8_t wifi_got_ip = 5;
+
+    class esp_link_emulator
+    {
+    public:
+        esp_link_emulator( serial::uart<> &uart, link_conditions conditions = {}, uint32_t seed = 1);
+
+        /**
+         * Move bytes over the serial line, as far as the current time allows, and handle
+         * every complete frame that arrives from the client.
+         *
+         * This must be called regularly, e.g. every time the clock advances.
+         */
+        void poll();
+
+        /// Simulate a restart of the esp-link: forget all callbacks and subscriptions and
+        /// announce the restart to the client with a sync packet.
+        void restart();
+
+        /// Publish a message from the broker side, as if it came from another MQTT client.
+        void publish( const std::string &topic, const std::string &payload);
+
+        /**
+         * Connect the esp-link to the broker, or lose the connection, and tell the client
+         * through its connected or disconnected callback. Messages published while the
+         * broker is unreachable are lost, just like subscriptions of the previous connection.
+         */
+        void set_broker_connected( bool connected);
+
+        /// Change the wifi status and report it to the client. Losing wifi also loses the broker.
+        void set_wifi_status( uint8_t status);
+
+        /// Set the time that is returned for CMD_GET_TIME, in seconds since the epoch.
+        void set_time( uint32_t seconds);
+
+        link_conditions &conditions()
+        {
+            return m_conditions;
+        }
+
+        bool synced() const
+        {
+            return m_synced;
+        }
+
+        /// Return whether no bytes are underway in either direction.
+        bool idle() const;
+
+        const std::vector<message> &published() const
+        {
+            return m_published;
+        }
+
+        void clear_published()
+        {
+            m_published.clear();
+        }
+
+        const counters &statistics() const
+        {
+            return m_counters;
+        }
+
+    private:
+        struct timed_byte
+        {
+            uint64_t    time;   ///< time at which the byte arrives, in microseconds
+            uint8_t     value;
+        };
+
+        /// one direction of the serial line
+        struct line
+        {
+            std::deque<timed_byte>  bytes;
+            uint64_t                busy_until = 0;
+        };
+
+        uint64_t now();
+        void enqueue( line &l, uint8_t value);
+        bool deliver( line &l, uint8_t &value);
+
+        void receive( uint8_t value);
+        void handle_frame( const std::vector<uint8_t> &frame);
+        void send_frame( uint16_t cmd, uint32_t value, const std::vector<std::string> &arguments = {});
+        void deliver_message( const std::string &topic, const std::string &payload);
+        void send_wifi_status();
+        void forget_callbacks();
+
+        serial::uart<>      &m_uart;
+        link_conditions     m_conditions;
+        std::mt19937        m_random;
+        counters            m_counters;
+
+        uint32_t            m_last_clock = 0;
+        uint64_t            m_time = 0;
+        line                m_to_emulator;
+        line                m_to_client;
+
+        std::vector<uint8_t> m_frame;
+        bool                m_escaped = false;
+
+        bool                m_synced = false;
+        uint32_t            m_epoch_seconds = 1500000000;
+        uint32_t            m_connected_callback = 0;
+        uint32_t            m_disconnected_callback = 0;
+        uint32_t            m_data_callback = 0;
+        uint32_t            m_wifi_callback = 0;
+        uint8_t             m_wifi_status = wifi_got_ip;
+        bool                m_broker_connected = true;
+        broker              m_broker;
+        std::vector<message> m_published;
+    };
+}
+
+#endif /* HOST_ESP_LINK_EMULATOR_HPP_ */
@@ -0,0 +1,139 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks that different ways of sending the same request produce the same bytes on the uart.
+ */
+#include "esp-link/client.hpp"
+#include "check.hpp"
+
+#include <avr/pgmspace.h>
+#include <avr_utilities/devices/uart.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    /// The bytes that the client sends for a single request.
+    template< typename Function>
+    std::vector<uint8_t> sent( Function f)
+    {
+        uart.clear_transmitted();
+        f();
+        uint8_t value;
+        while (esp.next_tx_byte( value)) uart.send( value);
+        auto bytes = uart.transmitted();
+        uart.clear_transmitted();
+        return bytes;
+    }
+
+    template< uint8_t... Bytes>
+    std::vector<uint8_t> bytes_of( esp_link::frame<Bytes...>)
+    {
+        return { Bytes...};
+    }
+
+    /// A precomputed frame must be exactly what execute() sends with the same arguments.
+    void check_precomputed_frames()
+    {
+        using esp_link::constant;
+        using esp_link::callback_events;
+        using esp_link::mqtt::publish;
+        using esp_link::mqtt::subscribe;
+
+        const auto subscribe_frame = esp_link::make_frame( subscribe, ESP_LINK_STRING( "/spider/LED"), constant<1>{});
+        CHECK( bytes_of( subscribe_frame) == sent( []{ esp.execute( subscribe, "/spider/LED", 1);}));
+        CHECK( bytes_of( subscribe_frame) == sent( [=]{ esp.send_frame( subscribe_frame);}));
+
+        // arguments that need SLIP escapes
+        const auto escaped_frame = esp_link::make_frame( subscribe, ESP_LINK_STRING( "/a\xc0\xdb/b"), constant<0xc0>{});
+        CHECK( bytes_of( escaped_frame) == sent( []{ esp.execute( subscribe, "/a\xc0\xdb/b", 0xc0);}));
+
+        const auto publish_frame = esp_link::make_frame( publish,
+                ESP_LINK_STRING( "/spider/temp"), ESP_LINK_STRING( "21.5"), constant<0>{}, constant<1>{});
+        CHECK( bytes_of( publish_frame) == sent( []{ esp.execute( publish, "/spider/temp", "21.5", 0, 1);}));
+
+        const auto events_frame = esp_link::make_frame( callback_events);
+        CHECK( bytes_of( events_frame) == sent( []{ esp.execute( callback_events);}));
+    }
+
+    /// a command with a plain binary parameter, which no esp-link command has (yet).
+    constexpr esp_link::command<142, void ( esp_link::binary)> send_blob{};
+
+    const uint8_t blob_P[] PROGMEM = { 0x00, esp_link::detail::SLIP_END, 0x01, esp_link::detail::SLIP_ESC, 0x00};
+
+    /**
+     * Binary arguments are sent with a length prefix and padding, followed by an extra
+     * length argument for binary_with_extra_len, whether they come from RAM or from flash.
+     */
+    void check_binary()
+    {
+        using esp_link::mqtt::publish_binary;
+        using esp_link::commands::CMD_MQTT_PUBLISH;
+
+        const uint8_t blob[] = { 0x00, esp_link::detail::SLIP_END, 0x01, esp_link::detail::SLIP_ESC, 0x00};
+        const std::string data( reinterpret_cast<const char *>( blob), sizeof blob);
+
+        // argument values as the esp-link receives them: topic, payload (5 bytes and 3 bytes of padding),
+        // the extra length (2 bytes and 2 bytes of padding), qos and retain.
+        const auto expected = check::esp_frame( CMD_MQTT_PUBLISH, 0,
+                { "/spider/raw", data, std::string( "\x05\x00", 2), std::string( 1, '\x01'), std::string( 1, '\x00')});
+        CHECK( expected == sent( [&]{ esp.execute( publish_binary, "/spider/raw", esp_link::span( blob), 1, 0);}));
+        CHECK( expected == sent( [&]{ esp.execute( publish_binary, "/spider/raw", esp_link::span_P( blob_P, sizeof blob_P), 1, 0);}));
+
+        const auto expected_blob = check::esp_frame( 142, 0, { data});
+        CHECK( expected_blob == sent( [&]{ esp.execute( send_blob, esp_link::span( blob));}));
+        CHECK( expected_blob == sent( [&]{ esp.execute( send_blob, esp_link::span_P( blob_P, sizeof blob_P));}));
+
+        // every amount of padding.
+        for (uint16_t size = 0; size <= 8; ++size)
+        {
+            const std::string bytes( size, '\x5a');
+            CHECK( check::esp_frame( 142, 0, { bytes}) == sent( [&]{ esp.execute( send_blob, esp_link::span( bytes.data(), size));}));
+        }
+    }
+
+    const char status_P[] PROGMEM = "{\"pir\":0,\"led\":1,\"uptime\":123456,\"rssi\":-67}";
+
+    /// All payload sources must produce the same frame as a payload from memory with the same data.
+    void check_payloads()
+    {
+        using esp_link::mqtt::publish;
+
+        static const char status[] = "{\"pir\":0,\"led\":1,\"uptime\":123456,\"rssi\":-67}";
+        const uint16_t length = sizeof status - 1;
+        const auto expected = sent( [&]{ esp.execute( publish, "/spider/status", esp_link::payload_from_memory( status, length), 1, 0);});
+        CHECK( expected == sent( [&]{ esp.execute( publish, "/spider/status", status, 1, 0);}));
+
+        CHECK( expected == sent( [&]{ esp.execute( publish, "/spider/status", esp_link::payload_P( status_P, length), 1, 0);}));
+
+        esp_link::ring_buffer<64> queue;
+        for (uint16_t index = 0; index < length; ++index) queue.push( status[index]);
+        CHECK( expected == sent( [&]{ esp.execute( publish, "/spider/status", esp_link::payload_from_queue( queue, length), 1, 0);}));
+        CHECK( queue.empty());
+
+        // a queue that runs empty is padded with zeros.
+        static const uint8_t padded[8] = { 'a', 'b', 'c'};
+        queue.push( 'a');
+        queue.push( 'b');
+        queue.push( 'c');
+        CHECK( sent( []{ esp.execute( publish, "/t", esp_link::payload_from_memory( padded, sizeof padded), 0, 0);})
+                == sent( [&]{ esp.execute( publish, "/t", esp_link::payload_from_queue( queue, sizeof padded), 0, 0);}));
+    }
+}
+
+int main()
+{
+    check_precomputed_frames();
+    check_payloads();
+    check_binary();
+    return check::result( "frame_check");
+}
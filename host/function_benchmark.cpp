@@ -0,0 +1,74 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Microbenchmark of function::function invocation.
+ *
+ * This compares the cost of calling a callback, as the esp-link client does for every
+ * callback packet, for each of the kinds of callables that a function can hold.
+ */
+#include "esp-link/packet.hpp"
+#include "function/function.hpp"
+
+#include <chrono>
+#include <stdio.h>
+
+namespace
+{
+    using callback_type = function::function<void (const esp_link::packet *)>;
+
+    uint32_t counter = 0;
+
+    void free_callback( const esp_link::packet *p)
+    {
+        counter += p->value;
+    }
+
+    struct handler
+    {
+        uint32_t count = 0;
+        void member_callback( const esp_link::packet *p)
+        {
+            count += p->value;
+        }
+    };
+
+    // keep the compiler from seeing what is being called
+    __attribute__((noinline))
+    void call_many( callback_type &f, const esp_link::packet *p, uint32_t calls)
+    {
+        while (calls--) f( p);
+    }
+
+    void bench( const char *name, callback_type f)
+    {
+        using bench_clock = std::chrono::steady_clock;
+        constexpr uint32_t calls = 100000000;
+
+        esp_link::packet p{};
+        p.cmd = 3;
+        p.value = 1;
+        const auto start = bench_clock::now();
+        call_many( f, &p, calls);
+        const double ns = std::chrono::duration<double, std::nano>( bench_clock::now() - start).count();
+        printf( "%-24s %6.2f ns/call\n", name, ns / calls);
+    }
+}
+
+int main()
+{
+    handler h;
+    uint32_t captured = 0;
+
+    bench( "free function",         &free_callback);
+    bench( "member function",       { &h, &handler::member_callback});
+    bench( "capturing lambda",      [&captured]( const esp_link::packet *p){ captured += p->value;});
+    bench( "functor, two captures", [&captured, &h]( const esp_link::packet *p){ captured += p->value; ++h.count;});
+    bench( "empty",                 nullptr);
+
+    return counter + h.count + captured == 0;
+}
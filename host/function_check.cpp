@@ -0,0 +1,161 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of function::function: empty functions, the kinds of callables it holds, and copying, moving
+ * and destroying function objects that it stores inline.
+ */
+#include "function/function.hpp"
+#include "check.hpp"
+
+namespace
+{
+    using int_function = function::function<int (int)>;
+    using void_function = function::function<void (int)>;
+
+    int last = 0;
+
+    int twice( int x)
+    {
+        return last = 2 * x;
+    }
+
+    void remember( int x)
+    {
+        last = x;
+    }
+
+    struct accumulator
+    {
+        int total = 0;
+        int add( int x)
+        {
+            return total += x;
+        }
+    };
+
+    /// function object with state that counts how many instances exist.
+    struct counted
+    {
+        static int live;
+        static int destroyed;
+
+        explicit counted( int start) : state{ start} { ++live;}
+        counted( const counted &other) : state{ other.state} { ++live;}
+        counted( counted &&other) : state{ other.state} { ++live;}
+        ~counted() { --live; ++destroyed;}
+
+        int operator()( int x)
+        {
+            return state += x;
+        }
+
+        int state;
+    };
+
+    int counted::live = 0;
+    int counted::destroyed = 0;
+
+    void check_empty()
+    {
+        int_function by_default;
+        int_function from_nullptr{ nullptr};
+        int_function from_null_pointer{ static_cast<int (*)(int)>( nullptr)};
+        CHECK( not by_default);
+        CHECK( not from_nullptr);
+        CHECK( not from_null_pointer);
+        CHECK( by_default( 5) == 0);
+        CHECK( from_null_pointer( 5) == 0);
+
+        last = 7;
+        void_function nothing;
+        nothing( 3);
+        CHECK( last == 7);
+
+        int_function copy{ by_default};
+        CHECK( not copy);
+        int_function moved{ static_cast<int_function &&>( copy)};
+        CHECK( not moved);
+    }
+
+    void check_callables()
+    {
+        int_function free{ &twice};
+        CHECK( free);
+        CHECK( free( 4) == 8 and last == 8);
+
+        void_function free_void{ &remember};
+        free_void( 11);
+        CHECK( last == 11);
+
+        accumulator a;
+        int_function member{ &a, &accumulator::add};
+        CHECK( member);
+        member( 2);
+        CHECK( member( 3) == 5 and a.total == 5);
+
+        int captured = 0;
+        void_function lambda{ [&captured]( int x){ captured += x;}};
+        CHECK( lambda);
+        lambda( 2);
+        lambda( 4);
+        CHECK( captured == 6);
+    }
+
+    /// Every stored function object is destroyed exactly once, and copies have their own state.
+    void check_stored_objects()
+    {
+        counted::live = 0;
+        counted::destroyed = 0;
+        {
+            int_function f{ counted{ 10}};
+            CHECK( counted::live == 1);
+            CHECK( f( 1) == 11);
+
+            int_function copy{ f};
+            CHECK( counted::live == 2);
+            CHECK( copy( 1) == 12);
+            CHECK( f( 5) == 16);                    // the copy did not change the original
+
+            int_function moved{ static_cast<int_function &&>( copy)};
+            CHECK( counted::live == 3);             // the moved-from function still holds its object
+            CHECK( moved( 1) == 13);
+
+            const int destroyed = counted::destroyed;
+            copy = f;                               // destroys the moved-from object
+            CHECK( counted::destroyed == destroyed + 1);
+            CHECK( counted::live == 3);
+            CHECK( copy( 0) == 16);
+
+            copy = copy;
+            CHECK( counted::live == 3);
+            CHECK( copy( 1) == 17);
+
+            moved = static_cast<int_function &&>( copy);
+            CHECK( counted::live == 3);
+            CHECK( moved( 0) == 17);
+
+            moved = nullptr;
+            CHECK( not moved);
+            CHECK( counted::live == 2);
+            CHECK( moved( 1) == 0);
+
+            f = &twice;
+            CHECK( counted::live == 1);
+            CHECK( f( 3) == 6);
+        }
+        CHECK( counted::live == 0);
+    }
+}
+
+int main()
+{
+    check_empty();
+    check_callables();
+    check_stored_objects();
+    return check::result( "function_check");
+}
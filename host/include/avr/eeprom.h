@@ -0,0 +1,164 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Host stand-in for avr-libc's <avr/eeprom.h>.
+ *
+ * The EEPROM is an array of E2END + 1 bytes in memory, which starts out erased (all 0xff).
+ * After host_eeprom::open(), the array is loaded from a file and every write goes through
+ * to that file, so that EEPROM contents survive a restart of the host program, just like
+ * they survive a reset of the AVR.
+ *
+ * The stand-in also counts the writes to every cell, to show how evenly code wears the EEPROM.
+ * Like the avr-libc update functions, eeprom_update_*() only write (and count) bytes that change.
+ */
+#ifndef HOST_AVR_EEPROM_H_
+#define HOST_AVR_EEPROM_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/// last EEPROM address of the atmega328p
+#define E2END 0x3FF
+
+namespace host_eeprom
+{
+    struct state
+    {
+        uint8_t     cells[E2END + 1];
+        uint32_t    writes[E2END + 1];
+        FILE        *file;
+
+        state()
+        : writes{}, file{ nullptr}
+        {
+            memset( cells, 0xff, sizeof cells);
+        }
+
+        ~state()
+        {
+            if (file) fclose( file);
+        }
+    };
+
+    inline state &eeprom()
+    {
+        static state instance;
+        return instance;
+    }
+
+    /**
+     * Use a file as backing store of the EEPROM. An existing file is loaded, a new file
+     * is created with erased contents. Returns false if the file can not be opened or created.
+     */
+    inline bool open( const char *path)
+    {
+        state &e = eeprom();
+        if (e.file) fclose( e.file);
+
+        e.file = fopen( path, "r+b");
+        if (e.file)
+        {
+            memset( e.cells, 0xff, sizeof e.cells);
+            if (fread( e.cells, 1, sizeof e.cells, e.file)) {}
+        }
+        else
+        {
+            e.file = fopen( path, "w+b");
+            if (!e.file) return false;
+            memset( e.cells, 0xff, sizeof e.cells);
+        }
+        fseek( e.file, 0, SEEK_SET);
+        fwrite( e.cells, 1, sizeof e.cells, e.file);
+        fflush( e.file);
+        return true;
+    }
+
+    /// Erase all cells, without counting this as writes.
+    inline void erase()
+    {
+        state &e = eeprom();
+        memset( e.cells, 0xff, sizeof e.cells);
+        if (e.file)
+        {
+            fseek( e.file, 0, SEEK_SET);
+            fwrite( e.cells, 1, sizeof e.cells, e.file);
+            fflush( e.file);
+        }
+    }
+
+    /// Number of times that the cell at address was written.
+    inline uint32_t writes( size_t address)
+    {
+        return address <= E2END ? eeprom().writes[address] : 0;
+    }
+
+    inline void write( size_t address, uint8_t value)
+    {
+        if (address > E2END) return;
+
+        state &e = eeprom();
+        e.cells[address] = value;
+        ++e.writes[address];
+        if (e.file)
+        {
+            fseek( e.file, address, SEEK_SET);
+            fputc( value, e.file);
+            fflush( e.file);
+        }
+    }
+
+    inline uint8_t read( size_t address)
+    {
+        return address <= E2END ? eeprom().cells[address] : 0xff;
+    }
+
+    inline size_t address_of( const void *pointer)
+    {
+        return reinterpret_cast<size_t>( pointer);
+    }
+}
+
+inline uint8_t eeprom_read_byte( const uint8_t *address)
+{
+    return host_eeprom::read( host_eeprom::address_of( address));
+}
+
+inline void eeprom_write_byte( uint8_t *address, uint8_t value)
+{
+    host_eeprom::write( host_eeprom::address_of( address), value);
+}
+
+inline void eeprom_update_byte( uint8_t *address, uint8_t value)
+{
+    const size_t a = host_eeprom::address_of( address);
+    if (host_eeprom::read( a) != value) host_eeprom::write( a, value);
+}
+
+inline void eeprom_read_block( void *destination, const void *source, size_t size)
+{
+    uint8_t *d = static_cast<uint8_t *>( destination);
+    for (size_t a = host_eeprom::address_of( source); size; --size) *d++ = host_eeprom::read( a++);
+}
+
+inline void eeprom_write_block( const void *source, void *destination, size_t size)
+{
+    const uint8_t *s = static_cast<const uint8_t *>( source);
+    for (size_t a = host_eeprom::address_of( destination); size; --size) host_eeprom::write( a++, *s++);
+}
+
+inline void eeprom_update_block( const void *source, void *destination, size_t size)
+{
+    const uint8_t *s = static_cast<const uint8_t *>( source);
+    for (size_t a = host_eeprom::address_of( destination); size; --size, ++a, ++s)
+    {
+        if (host_eeprom::read( a) != *s) host_eeprom::write( a, *s);
+    }
+}
+
+#endif /* HOST_AVR_EEPROM_H_ */
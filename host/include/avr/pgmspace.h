@@ -0,0 +1,51 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Host stand-in for avr-libc's <avr/pgmspace.h>.
+ *
+ * On the host there is only one address space, so "flash" data is ordinary
+ * constant data and the _P functions map onto their regular counterparts.
+ */
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR( s) (s)
+
+#define pgm_read_byte( address) (*reinterpret_cast<const uint8_t *>( address))
+
+inline uint16_t pgm_read_word( const void *address)
+{
+    uint16_t result;
+    memcpy( &result, address, sizeof result);
+    return result;
+}
+
+inline uint32_t pgm_read_dword( const void *address)
+{
+    uint32_t result;
+    memcpy( &result, address, sizeof result);
+    return result;
+}
+
+inline const void *pgm_read_ptr( const void *address)
+{
+    const void *result;
+    memcpy( &result, address, sizeof result);
+    return result;
+}
+
+#define strlen_P    strlen
+#define strcmp_P    strcmp
+#define strncmp_P   strncmp
+#define memcpy_P    memcpy
+#define memcmp_P    memcmp
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
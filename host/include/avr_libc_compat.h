@@ -0,0 +1,23 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * avr-libc functions that the firmware uses, but that are not part of the
+ * host's C library. This header is force-included in every host translation unit.
+ */
+#ifndef HOST_AVR_LIBC_COMPAT_H_
+#define HOST_AVR_LIBC_COMPAT_H_
+#include <stdlib.h>
+#include <stdio.h>
+
+inline char *itoa( int value, char *buffer, int radix)
+{
+    sprintf( buffer, radix == 16 ? "%x" : "%d", value);
+    return buffer;
+}
+
+#endif /* HOST_AVR_LIBC_COMPAT_H_ */
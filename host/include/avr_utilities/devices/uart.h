@@ -0,0 +1,110 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Host stand-in for the avr_utilities uart.
+ *
+ * This implements the subset of the serial::uart<> interface that the esp-link
+ * client uses, but instead of talking to a USART it keeps two in-memory byte queues:
+ * bytes that the host code feeds into the receive queue can be read by the client and
+ * everything the client sends ends up in the transmit queue, where the host code can
+ * inspect it.
+ */
+#ifndef HOST_AVR_UTILITIES_DEVICES_UART_H_
+#define HOST_AVR_UTILITIES_DEVICES_UART_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+namespace serial
+{
+    template< int buffer_size = 16>
+    class uart
+    {
+    public:
+        explicit uart( uint32_t baudrate = 19200)
+        : m_baudrate{ baudrate}
+        {
+        }
+
+        // interface used by the firmware
+
+        void send( uint8_t value)
+        {
+            m_transmitted.push_back( value);
+        }
+
+        void send( const char *string)
+        {
+            while (*string) send( static_cast<uint8_t>( *string++));
+        }
+
+        bool data_available() const
+        {
+            return !m_received.empty();
+        }
+
+        uint8_t get()
+        {
+            if (m_received.empty()) return 0;
+            const uint8_t value = m_received.front();
+            m_received.pop_front();
+            return value;
+        }
+
+        uint8_t read()
+        {
+            return get();
+        }
+
+        // interface for the host code that drives the mock
+
+        /// make bytes available for reading by the firmware
+        void feed( const uint8_t *data, size_t size)
+        {
+            m_received.insert( m_received.end(), data, data + size);
+        }
+
+        void feed( const std::vector<uint8_t> &data)
+        {
+            feed( data.data(), data.size());
+        }
+
+        /// number of bytes that were fed, but not yet read by the firmware
+        size_t pending() const
+        {
+            return m_received.size();
+        }
+
+        /// all bytes sent by the firmware since the last call to clear_transmitted()
+        const std::vector<uint8_t> &transmitted() const
+        {
+            return m_transmitted;
+        }
+
+        void clear_transmitted()
+        {
+            m_transmitted.clear();
+        }
+
+        uint32_t baudrate() const
+        {
+            return m_baudrate;
+        }
+
+    private:
+        uint32_t                m_baudrate;
+        std::deque<uint8_t>     m_received;
+        std::vector<uint8_t>    m_transmitted;
+    };
+}
+
+// there are no interrupts to implement on the host.
+#define IMPLEMENT_UART_INTERRUPT( uart_)
+
+#endif /* HOST_AVR_UTILITIES_DEVICES_UART_H_ */
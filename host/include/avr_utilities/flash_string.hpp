@@ -0,0 +1,22 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Host stand-in for the avr_utilities flash strings.
+ */
+#ifndef HOST_AVR_UTILITIES_FLASH_STRING_HPP_
+#define HOST_AVR_UTILITIES_FLASH_STRING_HPP_
+#include <avr/pgmspace.h>
+
+namespace flash_string
+{
+    class helper;
+}
+
+#define F_( string_literal) (reinterpret_cast<const flash_string::helper *>( PSTR( string_literal)))
+
+#endif /* HOST_AVR_UTILITIES_FLASH_STRING_HPP_ */
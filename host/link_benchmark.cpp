@@ -0,0 +1,358 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * End-to-end benchmark of the esp-link client against the emulated esp-link.
+ *
+ * All times are simulated: the clock only advances in small steps, and the serial line
+ * delivers bytes at the configured baud rate. The results therefore show the behavior of the
+ * protocol on a real 19200 baud link, including the effects of lost and corrupted bytes, but not
+ * the processing time of the microcontroller.
+ *
+ *     link_benchmark [capture-file]
+ *
+ * With a file name, all traffic on the client side of the line is captured to that file, in the
+ * format that the replay tool reads.
+ *
+ * The benchmark also checks a few results that must hold on any link, and returns nonzero
+ * if one of them does not.
+ */
+#include "esp-link/client.hpp"
+#include "esp-link/connection_tracker.hpp"
+#include "esp-link/publish_queue.hpp"
+#include "esp-link/statistics.hpp"
+#include "capture_file.hpp"
+#include "esp_link_emulator.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using timing::fake_clock;
+
+    using captured_uart = capture::capturing_transport<serial::uart<>, capture::capture_file>;
+
+    serial::uart<>              uart;
+    capture::capture_file       recorder;
+    captured_uart               client_side( uart, recorder);
+    esp_link::basic_client<captured_uart> esp( client_side);
+    esp_link::connection_tracker<decltype( esp)> broker( esp);
+    esp_link::publish_queue<decltype( esp), 4, 48, esp_link::eeprom_store<0, 512>> outbox( esp);
+    emulator::esp_link_emulator esp_link_side( uart);
+
+    constexpr uint32_t step_us = 50;
+
+    uint32_t messages_received = 0;
+    uint32_t subscriptions = 0;
+    uint32_t failures = 0;
+
+    void fail( const char *what)
+    {
+        ++failures;
+        fprintf( stderr, "link_benchmark: %s\n", what);
+    }
+
+    void on_data( const esp_link::packet *)
+    {
+        ++messages_received;
+    }
+
+    void on_link_up()
+    {
+        broker.start( &on_data);
+    }
+
+    void on_broker_change( bool reachable)
+    {
+        if (!reachable) return;
+        ++subscriptions;
+        esp.execute( esp_link::mqtt::subscribe, "/bench/echo", 0);
+    }
+
+    void step()
+    {
+        fake_clock::advance_us( step_us);
+        esp_link_side.poll();
+        esp.release( esp.try_receive());
+        outbox.poll();
+    }
+
+    /// run the simulation until the condition holds or until the timeout, return the elapsed time in microseconds,
+    /// or 0 on timeout.
+    template< typename Condition>
+    uint32_t run_until( Condition condition, uint32_t timeout_ms = 30000)
+    {
+        const uint32_t start = fake_clock::now_us();
+        while (not condition())
+        {
+            if (fake_clock::now_us() - start >= timeout_ms * 1000) return 0;
+            step();
+        }
+        return fake_clock::now_us() - start;
+    }
+
+    struct latency
+    {
+        uint32_t count      = 0;
+        uint32_t failures   = 0;
+        uint64_t total_us   = 0;
+        uint32_t max_us     = 0;
+
+        void add( uint32_t us)
+        {
+            if (!us)
+            {
+                ++failures;
+                return;
+            }
+            ++count;
+            total_us += us;
+            if (us > max_us) max_us = us;
+        }
+
+        void report( const char *name) const
+        {
+            printf( "  %-26s %8.2f ms avg %8.2f ms max %5u failed\n",
+                    name, count ? total_us / 1000.0 / count : 0.0, max_us / 1000.0, failures);
+        }
+    };
+
+    void bench_round_trip( uint32_t requests)
+    {
+        latency result;
+        for (uint32_t count = 0; count < requests; ++count)
+        {
+            bool done = false;
+            bool ok = false;
+            esp.execute_async( esp_link::get_time,
+                    [&done, &ok]( bool success, uint32_t){ done = true; ok = success;});
+            const uint32_t elapsed = run_until( [&done]{ return done;});
+            result.add( ok ? elapsed : 0);
+        }
+        result.report( "get_time round trip");
+    }
+
+    void bench_echo( uint32_t messages)
+    {
+        latency result;
+        for (uint32_t count = 0; count < messages; ++count)
+        {
+            const uint32_t before = messages_received;
+            esp.execute( esp_link::mqtt::publish, "/bench/echo", "0123456789abcdef", 0, 0);
+            result.add( run_until( [before]{ return messages_received != before;}, 2000));
+        }
+        result.report( "publish -> data callback");
+    }
+
+    void bench_publish_rate( uint32_t messages)
+    {
+        esp_link_side.clear_published();
+        const uint32_t start = fake_clock::now_us();
+        for (uint32_t count = 0; count < messages; ++count)
+        {
+            esp.execute( esp_link::mqtt::publish, "/bench/rate", "0123456789abcdef0123456789abcdef", 0, 0);
+        }
+        run_until( []{ return esp_link_side.idle();});
+        const double seconds = (fake_clock::now_us() - start) / 1e6;
+        printf( "  %-26s %8.1f msg/s  %5u of %u arrived\n",
+                "publish rate (32 bytes)", esp_link_side.published().size() / seconds,
+                static_cast<unsigned>( esp_link_side.published().size()), messages);
+    }
+
+    /// a restart that the client does not notice, because the sync packet got lost, counts as a failure.
+    void bench_recovery( uint32_t restarts)
+    {
+        latency result;
+        for (uint32_t count = 0; count < restarts; ++count)
+        {
+            esp_link_side.restart();
+            run_until( []{ return esp.state() != esp_link::link_state::up;}, 1000);
+            result.add( run_until( []{ return esp.state() == esp_link::link_state::up;}));
+            run_until( []{ return esp_link_side.idle();});
+        }
+        result.report( "recovery after restart");
+    }
+
+    enum class outage
+    {
+        esp_link,   ///< the esp-link restarts and the serial line is dead
+        wifi        ///< the esp-link is fine, but it lost wifi and with that the broker
+    };
+
+    /**
+     * Publish sensor values through the outbox while the broker is unreachable for a while,
+     * then measure how long it takes to deliver what was queued.
+     *
+     * This fails if the latest value of a sensor does not arrive, or if the outbox writes an EEPROM
+     * cell more often than it would if it spread its writes evenly over all slots of the store.
+     */
+    void bench_outage( outage kind, uint32_t outage_ms, uint8_t sensors)
+    {
+        printf( "%s outage of %u ms, %u sensors publishing every 100 ms\n",
+                kind == outage::wifi ? "wifi" : "esp-link", outage_ms, sensors);
+        esp_link_side.clear_published();
+        const uint16_t coalesced = outbox.coalesced();
+        const uint16_t spilled = outbox.spilled();
+        const uint16_t dropped = outbox.dropped();
+        const uint32_t lost = esp_link_side.statistics().publishes_lost;
+        const uint32_t subscribed = subscriptions;
+        std::vector<uint32_t> writes_before( 512);
+        for (size_t address = 0; address < writes_before.size(); ++address) writes_before[address] = host_eeprom::writes( address);
+
+        if (kind == outage::wifi)
+        {
+            esp_link_side.set_wifi_status( 1); // connecting
+            run_until( []{ return !broker.broker_reachable();}, 1000);
+        }
+        else
+        {
+            esp_link_side.restart();
+            run_until( []{ return esp.state() != esp_link::link_state::up;}, 1000);
+            esp_link_side.conditions().loss_rate = 1;
+        }
+
+        std::vector<std::string> last_values( sensors);
+        uint32_t published = 0;
+        for (uint32_t time = 0; time < outage_ms; time += 100)
+        {
+            for (uint8_t sensor = 0; sensor < sensors; ++sensor)
+            {
+                const std::string topic = "/bench/sensor/" + std::to_string( sensor);
+                last_values[sensor] = std::to_string( published++);
+                outbox.publish( topic.c_str(), last_values[sensor].c_str());
+            }
+            run_until( []{ return false;}, 100);
+        }
+
+        esp_link_side.conditions().loss_rate = 0;
+        if (kind == outage::wifi)
+        {
+            esp_link_side.set_wifi_status( emulator::wifi_got_ip);
+            esp_link_side.set_broker_connected( true);
+        }
+        const uint32_t queued = outbox.size();
+        const uint32_t reachable = run_until( []{ return broker.broker_reachable();});
+        const uint32_t drained = run_until( []{ return outbox.empty() and esp_link_side.idle();});
+
+        uint32_t correct = 0;
+        for (const auto &m : esp_link_side.published())
+        {
+            const auto sensor = strtoul( m.topic.c_str() + 14, nullptr, 10);
+            if (sensor < sensors and m.payload == last_values[sensor]) ++correct;
+        }
+
+        uint32_t max_writes = 0;
+        for (size_t address = 0; address < writes_before.size(); ++address)
+        {
+            const uint32_t writes = host_eeprom::writes( address) - writes_before[address];
+            if (writes > max_writes) max_writes = writes;
+        }
+
+        printf( "  %u published, %u queued at the end of the outage: %u coalesced, %u written to EEPROM, %u dropped\n",
+                published, queued, outbox.coalesced() - coalesced, outbox.spilled() - spilled, outbox.dropped() - dropped);
+        printf( "  broker reachable %.2f ms after the outage, queue delivered in %.2f ms, %u of %u latest values arrived\n",
+                reachable / 1000.0, drained / 1000.0, correct, sensors);
+        printf( "  %u messages lost at the broker, %u subscriptions renewed\n",
+                esp_link_side.statistics().publishes_lost - lost, subscriptions - subscribed);
+        printf( "  at most %u writes to a single EEPROM cell\n", max_writes);
+
+        if (correct < sensors) fail( "not all latest values arrived after an outage");
+
+        // every stored message writes each cell of one slot at most once, and sending it writes its state once more.
+        const uint32_t stored = static_cast<uint16_t>( outbox.spilled() - spilled);
+        const uint32_t slots = decltype( outbox)::store_slots;
+        if (max_writes > (stored + slots - 1) / slots + 1) fail( "the outbox does not spread its writes over the EEPROM");
+    }
+
+    /**
+     * Publish the link statistics of the client and check that the broker receives exactly
+     * the counters that the client had at that moment.
+     */
+    void check_statistics()
+    {
+        const auto conditions = esp_link_side.conditions();
+        esp_link_side.conditions().loss_rate = 0;
+        esp_link_side.conditions().corruption_rate = 0;
+        run_until( []{ return esp_link_side.idle();});
+        esp_link_side.clear_published();
+
+        uint8_t counters[esp_link::link_statistics::serialized_size];
+        esp.statistics().serialize( counters);
+        esp_link::publish_statistics( esp, "/bench/link");
+        run_until( []{ return esp_link_side.idle();});
+        esp_link_side.conditions() = conditions;
+
+        const auto &published = esp_link_side.published();
+        if (published.size() != 1 or published.front().topic != "/bench/link")
+        {
+            fail( "link statistics were not published");
+        }
+        else if (published.front().payload != std::string( reinterpret_cast<const char *>( counters), sizeof counters))
+        {
+            fail( "published link statistics differ from the counters of the client");
+        }
+    }
+
+    void scenario( const char *name, double loss, double corruption)
+    {
+        esp_link_side.conditions().loss_rate = loss;
+        esp_link_side.conditions().corruption_rate = corruption;
+        printf( "%s (loss %.1f%%, corruption %.1f%%)\n", name, loss * 100, corruption * 100);
+
+        bench_round_trip( 200);
+        bench_echo( 200);
+        bench_publish_rate( 200);
+        bench_recovery( 20);
+
+        const auto &counters = esp_link_side.statistics();
+        const auto &client = esp.statistics();
+        printf( "  client: %u packets, %u crc errors, %u dropped; emulator: %u frames, %u crc errors\n",
+                client.packets_received, client.crc_errors, client.dropped_frames,
+                counters.frames_received, counters.crc_errors);
+        check_statistics();
+        esp.reset_statistics();
+    }
+}
+
+int main( int argc, char *argv[])
+{
+    if (argc > 1 and !recorder.open( argv[1]))
+    {
+        fprintf( stderr, "can not create %s\n", argv[1]);
+        return 1;
+    }
+
+    printf( "emulated link at %u baud\n", esp_link_side.conditions().baudrate);
+
+    esp.on_link_up( &on_link_up);
+    broker.on_change( &on_broker_change);
+    outbox.send_when( []{ return broker.broker_reachable();});
+    esp.connect();
+    if (!run_until( []{ return broker.broker_reachable();}))
+    {
+        printf( "no link\n");
+        return 1;
+    }
+    run_until( []{ return esp_link_side.idle();});
+
+    scenario( "clean link",  0,     0);
+    scenario( "lossy link",  0.001, 0);
+    scenario( "noisy link",  0,     0.001);
+    scenario( "bad link",    0.005, 0.005);
+
+    esp_link_side.conditions().loss_rate = 0;
+    esp_link_side.conditions().corruption_rate = 0;
+    bench_outage( outage::esp_link, 5000, 4);
+    bench_outage( outage::esp_link, 5000, 12);
+    bench_outage( outage::wifi, 5000, 12);
+    bench_outage( outage::esp_link, 20000, 12);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of the callback registry: handles, the free list, clear() and stale handles.
+ */
+#include "esp-link/callback_registry.hpp"
+#include "function/function.hpp"
+#include "check.hpp"
+
+#include <vector>
+
+namespace
+{
+    using callback = function::function<void ()>;
+    using registry = esp_link::callback_registry<4, callback>;
+
+    unsigned calls = 0;
+
+    void count()
+    {
+        ++calls;
+    }
+
+    bool call( registry &r, uint32_t handle)
+    {
+        const callback *f = r.find( handle);
+        if (f) callback{ *f}();
+        return f != nullptr;
+    }
+
+    void check_add_and_remove()
+    {
+        registry r;
+        CHECK( r.add( callback{}) == registry::invalid_handle);
+
+        std::vector<uint32_t> handles;
+        for (uint8_t count = 0; count < registry::capacity(); ++count) handles.push_back( r.add( &::count));
+        CHECK( r.size() == registry::capacity());
+        CHECK( r.add( &::count) == registry::invalid_handle);
+
+        bool distinct = true;
+        for (size_t index = 0; index < handles.size(); ++index)
+        {
+            distinct = distinct and handles[index] != registry::invalid_handle;
+            for (size_t other = 0; other < index; ++other) distinct = distinct and handles[index] != handles[other];
+        }
+        CHECK( distinct);
+
+        calls = 0;
+        for (auto handle : handles) call( r, handle);
+        CHECK( calls == registry::capacity());
+
+        CHECK( r.remove( handles[1]));
+        CHECK( not r.remove( handles[1]));
+        CHECK( r.find( handles[1]) == nullptr);
+        CHECK( r.size() == registry::capacity() - 1);
+        CHECK( not r.remove( registry::invalid_handle));
+        CHECK( not r.remove( handles[0] + 0x10000000));     // bits above the generation
+        CHECK( r.find( 0xff) == nullptr);                   // position out of range
+    }
+
+    /// A removed position is used again, with a handle that differs from the old one.
+    void check_reuse()
+    {
+        registry r;
+        std::vector<uint32_t> handles;
+        for (uint8_t count = 0; count < registry::capacity(); ++count) handles.push_back( r.add( &::count));
+
+        CHECK( r.remove( handles[2]));
+        CHECK( r.remove( handles[0]));
+
+        // the free list hands out the most recently removed position first.
+        const uint32_t first = r.add( &::count);
+        const uint32_t second = r.add( &::count);
+        CHECK( (first & 0xff) == (handles[0] & 0xff) and first != handles[0]);
+        CHECK( (second & 0xff) == (handles[2] & 0xff) and second != handles[2]);
+        CHECK( r.add( &::count) == registry::invalid_handle);
+
+        CHECK( r.find( handles[0]) == nullptr);
+        CHECK( r.find( handles[2]) == nullptr);
+        CHECK( r.find( first) != nullptr and r.find( second) != nullptr);
+    }
+
+    void check_clear()
+    {
+        registry r;
+        std::vector<uint32_t> handles;
+        for (uint8_t count = 0; count < registry::capacity(); ++count) handles.push_back( r.add( &::count));
+
+        r.clear();
+        CHECK( r.size() == 0);
+        bool none = true;
+        for (auto handle : handles) none = none and r.find( handle) == nullptr and not r.remove( handle);
+        CHECK( none);
+
+        // all positions are free again, with new handles.
+        bool fresh = true;
+        for (uint8_t count = 0; count < registry::capacity(); ++count)
+        {
+            const uint32_t handle = r.add( &::count);
+            fresh = fresh and handle != registry::invalid_handle;
+            for (auto old : handles) fresh = fresh and handle != old;
+        }
+        CHECK( fresh);
+    }
+
+    /// A stale handle stays invalid until its position has gone through all 65535 generations.
+    void check_stale_handle()
+    {
+        registry r;
+        const uint32_t stale = r.add( &::count);
+        uint32_t handle = stale;
+        bool rejected = true;
+        for (uint32_t reuse = 1; reuse < 0xffff; ++reuse)
+        {
+            r.remove( handle);
+            handle = r.add( &::count);
+            rejected = rejected and handle != stale and r.find( stale) == nullptr;
+        }
+        CHECK( rejected);
+
+        r.remove( handle);
+        CHECK( r.add( &::count) == stale);
+    }
+}
+
+int main()
+{
+    check_add_and_remove();
+    check_reuse();
+    check_clear();
+    check_stale_handle();
+    return check::result( "registry_check");
+}
@@ -0,0 +1,270 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Replay of captured serial traffic into the esp-link client.
+ *
+ *     replay [-f] [-p poll_interval_us] [-e expected-file] capture-file...
+ *
+ * The received bytes of every capture file (@see capture_file.hpp) are fed to a fresh client.
+ * By default, bytes are fed at their original times: the (fake) clock is advanced in steps of the poll
+ * interval, as a main loop would do, and every step makes the bytes that arrived in the meantime available
+ * to try_receive(). This reproduces timeouts and resynchronization as they happened, in simulated time.
+ * With -f, all bytes are available at once and the client decodes at maximum speed.
+ *
+ * For every file this reports the number of decoded frames, crc failures and dropped frames, and the
+ * time that try_receive() spent on each frame. The frame counts are deterministic, so a corpus
+ * of captures doubles as a regression test of the decoder, while the decode times show
+ * performance regressions.
+ *
+ * With -e, the counts are compared with those in the expected-file, which has a line per capture and mode:
+ *
+ *     <capture file name> <timed|fast> <frames decoded> <crc failures> <dropped frames>
+ *
+ * The capture file name is without its directory, lines starting with '#' are ignored. replay returns
+ * nonzero if a count differs or if a capture has no expected counts.
+ */
+#include "esp-link/client.hpp"
+#include "capture_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+    using timing::fake_clock;
+
+    struct options
+    {
+        bool        fast = false;
+        uint32_t    poll_interval_us = 1000;
+        const char  *expected = nullptr;
+    };
+
+    /// The counts that replaying a capture in one mode should give.
+    struct expectation
+    {
+        std::string capture;
+        bool        fast;
+        unsigned    frames;
+        unsigned    crc_errors;
+        unsigned    dropped;
+    };
+
+    /**
+     * Read a file with expected counts. Returns false if the file can not be opened or contains
+     * a line that is not in the right format, line is then set to the offending line number.
+     */
+    bool read_expectations( const char *path, std::vector<expectation> &expectations, unsigned &line)
+    {
+        FILE *file = fopen( path, "r");
+        line = 0;
+        if (!file) return false;
+
+        char text[200];
+        bool ok = true;
+        while (ok and fgets( text, sizeof text, file))
+        {
+            ++line;
+            if (text[0] == '#' or text[0] == '\n' or text[0] == '\r') continue;
+
+            char capture[128];
+            char mode[6];
+            expectation e;
+            ok = sscanf( text, "%127s %5s %u %u %u", capture, mode, &e.frames, &e.crc_errors, &e.dropped) == 5
+                    and (!strcmp( mode, "timed") or !strcmp( mode, "fast"));
+            if (ok)
+            {
+                e.capture = capture;
+                e.fast = mode[0] == 'f';
+                expectations.push_back( e);
+            }
+        }
+
+        fclose( file);
+        return ok;
+    }
+
+    struct replay_result
+    {
+        uint32_t                rx_bytes = 0;
+        uint32_t                tx_bytes = 0;
+        esp_link::link_statistics statistics;
+        std::vector<uint32_t>   decode_ns;  ///< time spent in try_receive() for each frame
+    };
+
+    uint32_t frames( const esp_link::link_statistics &s)
+    {
+        return s.packets_received + s.crc_errors + s.dropped_frames;
+    }
+
+    /**
+     * Call try_receive() until all bytes that are available have been consumed. The time spent is added
+     * to the frame that is being received, every time a frame ends a new measurement starts.
+     */
+    void poll( esp_link::client &esp, serial::uart<> &uart, replay_result &result, uint64_t &frame_ns)
+    {
+        while (uart.data_available())
+        {
+            const uint32_t before = frames( esp.statistics());
+            const auto start = bench_clock::now();
+            const auto p = esp.try_receive();
+            frame_ns += std::chrono::duration_cast<std::chrono::nanoseconds>( bench_clock::now() - start).count();
+            esp.release( p);
+
+            if (frames( esp.statistics()) != before)
+            {
+                result.decode_ns.push_back( frame_ns);
+                frame_ns = 0;
+            }
+        }
+        uart.clear_transmitted();
+    }
+
+    replay_result replay( const std::vector<capture::captured_byte> &bytes, const options &opts)
+    {
+        replay_result result;
+        serial::uart<> uart;
+        std::unique_ptr<esp_link::client> esp{ new esp_link::client( uart)};
+        uint64_t frame_ns = 0;
+
+        fake_clock::set_us( 0);
+        const uint64_t start = bytes.empty() ? 0 : bytes.front().time;
+        uint64_t now = 0;
+        for (const auto &b : bytes)
+        {
+            if (b.dir == capture::direction::tx)
+            {
+                ++result.tx_bytes;
+                continue;
+            }
+            ++result.rx_bytes;
+
+            // let the main loop run until the byte arrives.
+            while (not opts.fast and start + now < b.time)
+            {
+                poll( *esp, uart, result, frame_ns);
+                now += opts.poll_interval_us;
+                fake_clock::set_us( static_cast<uint32_t>( now));
+            }
+            uart.feed( &b.value, 1);
+        }
+        poll( *esp, uart, result, frame_ns);
+
+        result.statistics = esp->statistics();
+        return result;
+    }
+
+    void report( const char *name, replay_result &result)
+    {
+        const auto &s = result.statistics;
+        printf( "%s\n", name);
+        printf( "  %u bytes received, %u bytes sent\n", result.rx_bytes, result.tx_bytes);
+        printf( "  %u frames decoded, %u crc failures, %u dropped, %u unknown callbacks, %u syncs\n",
+                s.packets_received, s.crc_errors, s.dropped_frames, s.unknown_callbacks, s.syncs);
+
+        auto &ns = result.decode_ns;
+        if (ns.empty()) return;
+        std::sort( ns.begin(), ns.end());
+        uint64_t total = 0;
+        for (auto value : ns) total += value;
+        printf( "  decode time per frame: %8.0f ns avg %8u ns median %8u ns p99 %8u ns max\n",
+                static_cast<double>( total) / ns.size(), ns[ns.size() / 2], ns[ns.size() * 99 / 100], ns.back());
+    }
+
+    /// Compare the counts of a replay with the expected ones, report any difference and return whether they match.
+    bool matches( const char *path, const replay_result &result, bool fast, const std::vector<expectation> &expectations)
+    {
+        const char *slash = strrchr( path, '/');
+        const std::string name = slash ? slash + 1 : path;
+        const char *mode = fast ? "fast" : "timed";
+        for (const auto &e : expectations)
+        {
+            if (e.capture != name or e.fast != fast) continue;
+
+            const auto &s = result.statistics;
+            const bool same = s.packets_received == e.frames and s.crc_errors == e.crc_errors and s.dropped_frames == e.dropped;
+            if (!same)
+            {
+                fprintf( stderr, "%s (%s): expected %u frames, %u crc failures, %u dropped, got %u, %u, %u\n",
+                        path, mode, e.frames, e.crc_errors, e.dropped, s.packets_received, s.crc_errors, s.dropped_frames);
+            }
+            return same;
+        }
+        fprintf( stderr, "%s (%s): no expected counts\n", path, mode);
+        return false;
+    }
+
+    void usage()
+    {
+        fprintf( stderr, "usage: replay [-f] [-p poll_interval_us] [-e expected-file] capture-file...\n");
+    }
+}
+
+int main( int argc, char *argv[])
+{
+    options opts;
+    int arg = 1;
+    for (; arg < argc and argv[arg][0] == '-'; ++arg)
+    {
+        if (!strcmp( argv[arg], "-f"))
+        {
+            opts.fast = true;
+        }
+        else if (!strcmp( argv[arg], "-p") and arg + 1 < argc)
+        {
+            opts.poll_interval_us = strtoul( argv[++arg], nullptr, 10);
+            if (!opts.poll_interval_us) opts.poll_interval_us = 1;
+        }
+        else if (!strcmp( argv[arg], "-e") and arg + 1 < argc)
+        {
+            opts.expected = argv[++arg];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (arg == argc)
+    {
+        usage();
+        return 2;
+    }
+
+    std::vector<expectation> expectations;
+    unsigned line;
+    if (opts.expected and !read_expectations( opts.expected, expectations, line))
+    {
+        fprintf( stderr, "%s:%u: can not read expected counts\n", opts.expected, line);
+        return 2;
+    }
+
+    int status = 0;
+    for (; arg < argc; ++arg)
+    {
+        std::vector<capture::captured_byte> bytes;
+        if (!capture::read_capture_file( argv[arg], bytes, line))
+        {
+            fprintf( stderr, "%s:%u: can not read capture\n", argv[arg], line);
+            status = 1;
+            continue;
+        }
+
+        auto result = replay( bytes, opts);
+        report( argv[arg], result);
+        if (opts.expected and !matches( argv[arg], result, opts.fast, expectations)) status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,129 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of the MQTT topic router, with data callbacks that arrive through the client.
+ */
+#include "esp-link/client.hpp"
+#include "esp-link/mqtt_router.hpp"
+#include "check.hpp"
+
+#include <avr_utilities/devices/uart.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    using esp_link::commands::CMD_RESP_CB;
+
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    unsigned led_calls  = 0;
+    unsigned ir_calls   = 0;
+    unsigned temp_calls = 0;
+    std::string last_payload;
+
+    void remember_payload( const esp_link::packet *p)
+    {
+        const auto payload = esp.arguments( p)[1];
+        last_payload.assign( payload.chars(), payload.size);
+    }
+
+    void on_led( const esp_link::packet *p)
+    {
+        ++led_calls;
+        remember_payload( p);
+    }
+
+    void on_ir( const esp_link::packet *p)
+    {
+        ++ir_calls;
+        remember_payload( p);
+    }
+
+    void on_temp( const esp_link::packet *p)
+    {
+        ++temp_calls;
+        remember_payload( p);
+    }
+
+    using topics = esp_link::mqtt::router<
+            esp_link::mqtt::route< ESP_LINK_STRING_T( "/spider/LED"),  &on_led>,
+            esp_link::mqtt::route< ESP_LINK_STRING_T( "/spider/IR"),   &on_ir>,
+            esp_link::mqtt::route< ESP_LINK_STRING_T( "/spider/temp"), &on_temp>
+            >;
+
+    unsigned total_calls()
+    {
+        return led_calls + ir_calls + temp_calls;
+    }
+
+    void feed( const std::vector<uint8_t> &frame)
+    {
+        uart.feed( frame);
+        while (uart.data_available()) esp.release( esp.try_receive());
+    }
+
+    void check_routing( uint32_t handle)
+    {
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "/spider/IR", "on"}));
+        CHECK( ir_calls == 1 and total_calls() == 1);
+        CHECK( last_payload == "on");
+
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "/spider/LED", "1"}));
+        CHECK( led_calls == 1 and total_calls() == 2);
+        CHECK( last_payload == "1");
+
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "/spider/temp", "21.5"}));
+        CHECK( temp_calls == 1 and total_calls() == 3);
+        CHECK( last_payload == "21.5");
+    }
+
+    void check_no_route( uint32_t handle)
+    {
+        const unsigned before = total_calls();
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "/spider/LEDs", "1"}));
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "/spider/LEX", "1"}));
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "/spider/le", "1"}));
+        feed( check::esp_frame( CMD_RESP_CB, handle, { "", "1"}));
+        feed( check::esp_frame( CMD_RESP_CB, handle));
+        CHECK( total_calls() == before);
+    }
+
+    /// Topics whose length runs past the end of the packet are ignored, even if the
+    /// bytes that are there match a route.
+    void check_truncated( uint32_t handle)
+    {
+        const unsigned before = total_calls();
+        for (uint16_t length : { 13, 16, 200, 0xffff})
+        {
+            auto raw = check::raw_packet( CMD_RESP_CB, handle, { "/spider/LED"});
+            raw[8] = length;
+            raw[9] = length >> 8;
+            feed( check::slip_frame( raw));
+        }
+        CHECK( total_calls() == before);
+        CHECK( esp.statistics().crc_errors == 0);
+
+        // the same packet, with the correct length.
+        feed( check::slip_frame( check::raw_packet( CMD_RESP_CB, handle, { "/spider/LED"})));
+        CHECK( total_calls() == before + 1);
+    }
+}
+
+int main()
+{
+    const uint32_t handle = esp.register_callback( topics::dispatcher( esp));
+    CHECK( handle != 0);
+
+    check_routing( handle);
+    check_no_route( handle);
+    check_truncated( handle);
+    return check::result( "router_check");
+}
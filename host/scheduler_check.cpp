@@ -0,0 +1,173 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of the scheduler, in simulated time.
+ */
+#include "scheduler/scheduler.hpp"
+#include "timing/fake_clock.hpp"
+#include "check.hpp"
+
+namespace
+{
+    using timing::fake_clock;
+    using scheduler_type = scheduler::scheduler< fake_clock, 2, 2>;
+
+    unsigned calls = 0;
+    uint32_t busy_us = 0;   ///< time that the next callback takes
+
+    void count()
+    {
+        ++calls;
+    }
+
+    void work()
+    {
+        fake_clock::advance_us( busy_us);
+    }
+
+    /// run the scheduler once every millisecond, until the given time (in ms since the start of the check).
+    void run_until( scheduler_type &s, uint32_t start_ms, uint32_t ms)
+    {
+        while (fake_clock::now_ms() - start_ms < ms)
+        {
+            fake_clock::advance_ms( 1);
+            s.run_once();
+        }
+    }
+
+    void check_one_shot()
+    {
+        scheduler_type s;
+        const uint32_t start = fake_clock::now_ms();
+        calls = 0;
+
+        CHECK( s.after( 100, &count) != scheduler_type::invalid_timer);
+        run_until( s, start, 99);
+        CHECK( calls == 0);
+        run_until( s, start, 100);
+        CHECK( calls == 1);
+        run_until( s, start, 300);
+        CHECK( calls == 1);
+
+        // both positions are free again.
+        CHECK( s.after( 10, &count) != scheduler_type::invalid_timer);
+        CHECK( s.after( 10, &count) != scheduler_type::invalid_timer);
+        CHECK( s.after( 10, &count) == scheduler_type::invalid_timer);
+    }
+
+    void check_periodic()
+    {
+        scheduler_type s;
+        const uint32_t start = fake_clock::now_ms();
+        calls = 0;
+
+        const auto id = s.every( 50, &count);
+        run_until( s, start, 49);
+        CHECK( calls == 0);
+        run_until( s, start, 160);
+        CHECK( calls == 3);
+
+        s.cancel( id);
+        run_until( s, start, 300);
+        CHECK( calls == 3);
+    }
+
+    /**
+     * A periodic timer that is polled late keeps its phase if it is less than a period late,
+     * and does not try to catch up on missed periods if it is later than that.
+     */
+    void check_late_poll()
+    {
+        scheduler_type s;
+        const uint32_t start = fake_clock::now_ms();
+        calls = 0;
+
+        s.every( 50, &count);
+        fake_clock::advance_ms( 60);
+        s.run_once();
+        CHECK( calls == 1);
+        run_until( s, start, 99);
+        CHECK( calls == 1);
+        run_until( s, start, 100);
+        CHECK( calls == 2);
+
+        // more than three periods late: one call, then one period from now.
+        fake_clock::advance_ms( 175);
+        s.run_once();
+        CHECK( calls == 3);
+        s.run_once();
+        CHECK( calls == 3);
+        run_until( s, start, 324);
+        CHECK( calls == 3);
+        run_until( s, start, 325);
+        CHECK( calls == 4);
+    }
+
+    void check_max_us()
+    {
+        scheduler_type s;
+        const uint32_t start = fake_clock::now_ms();
+
+        const auto task = s.add_task( &work);
+        const auto timer = s.every( 10, &work);
+        CHECK( task != scheduler_type::invalid_id);
+
+        for (uint32_t us : { 300, 800, 100})
+        {
+            busy_us = us;
+            fake_clock::advance_ms( 10);
+            s.run_once();
+        }
+        CHECK( s.task_max_us( task) == 800);
+        CHECK( s.timer_max_us( timer) == 800);
+
+        // run times that do not fit are reported as the maximum.
+        busy_us = 70000;
+        s.run_once();
+        CHECK( s.task_max_us( task) == 0xffff);
+
+        busy_us = 0;
+        s.reset_statistics();
+        CHECK( s.task_max_us( task) == 0);
+        CHECK( s.timer_max_us( timer) == 0);
+        run_until( s, start, 100);
+    }
+
+    /// The id of a timer that stopped does not cancel a later timer at the same position.
+    void check_stale_cancel()
+    {
+        scheduler_type s;
+        const uint32_t start = fake_clock::now_ms();
+        calls = 0;
+
+        const auto expired = s.after( 10, &count);
+        run_until( s, start, 10);
+        CHECK( calls == 1);
+
+        const auto cancelled = s.after( 10, &count);
+        CHECK( (cancelled & 0xff) == (expired & 0xff));
+        s.cancel( cancelled);
+
+        const auto current = s.after( 10, &count);
+        CHECK( (current & 0xff) == (expired & 0xff));
+        s.cancel( expired);
+        s.cancel( cancelled);
+        run_until( s, start, 30);
+        CHECK( calls == 2);
+    }
+}
+
+int main()
+{
+    check_one_shot();
+    check_periodic();
+    check_late_poll();
+    check_max_us();
+    check_stale_cancel();
+    return check::result( "scheduler_check");
+}
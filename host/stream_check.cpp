@@ -0,0 +1,159 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of the reception of frames that are larger than a receive buffer, through the mock uart.
+ */
+#include "esp-link/client.hpp"
+#include "check.hpp"
+
+#include <avr_utilities/devices/uart.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    /// What the stream handler saw of a single frame.
+    struct streamed
+    {
+        unsigned                    begins      = 0;
+        unsigned                    ends        = 0;
+        bool                        valid       = false;
+        esp_link::packet            header{};
+        std::vector<std::string>    arguments;
+        uint16_t                    last_argument = 0;
+        bool                        in_order    = true;
+        uint8_t                     max_chunk   = 0;
+        std::vector<const uint8_t *> chunk_buffers;
+    };
+
+    streamed seen;
+    bool accept = true;
+
+    esp_link::stream_handler handler{
+        []( const esp_link::packet *header)
+        {
+            ++seen.begins;
+            seen.header = *header;
+            return accept;
+        },
+        []( uint16_t argument, const uint8_t *data, uint8_t size)
+        {
+            if (argument < seen.last_argument or size == 0) seen.in_order = false;
+            seen.last_argument = argument;
+            if (seen.arguments.size() <= argument) seen.arguments.resize( argument + 1);
+            seen.arguments[argument].append( reinterpret_cast<const char *>( data), size);
+            if (size > seen.max_chunk) seen.max_chunk = size;
+            seen.chunk_buffers.push_back( data);
+        },
+        []( bool valid)
+        {
+            ++seen.ends;
+            seen.valid = valid;
+        }
+    };
+
+    std::mt19937 random_bytes{ 42};
+
+    /// arguments of the given sizes, with random contents, which include bytes that need SLIP escapes.
+    std::vector<std::string> make_arguments( const std::vector<uint16_t> &sizes)
+    {
+        std::vector<std::string> result;
+        for (auto size : sizes)
+        {
+            std::string argument;
+            for (uint16_t count = 0; count < size; ++count)
+            {
+                const uint8_t value = count % 37 == 5 ? esp_link::detail::SLIP_END : random_bytes();
+                argument.push_back( static_cast<char>( value));
+            }
+            result.push_back( argument);
+        }
+        return result;
+    }
+
+    void feed( const std::vector<uint8_t> &frame)
+    {
+        seen = streamed{};
+        uart.feed( frame);
+        while (uart.data_available()) esp.release( esp.try_receive());
+    }
+
+    /**
+     * Stream a frame with arguments of the given sizes and check what the handler sees.
+     * If last_padded is false, the padding of the last argument is left out.
+     */
+    void check_frame( const std::vector<uint16_t> &sizes, bool last_padded = true)
+    {
+        const auto arguments = make_arguments( sizes);
+        auto raw = check::raw_packet( 200, 0x12345678, arguments);
+        if (not last_padded) raw.resize( raw.size() - ((4 - (sizes.back() & 3)) & 3));
+        const size_t frame_size = raw.size() + 2;
+        CHECK( frame_size > 128 and frame_size <= 1024);
+
+        const auto before = esp.statistics();
+        feed( check::slip_frame( raw));
+        CHECK( seen.begins == 1 and seen.ends == 1);
+        CHECK( seen.valid);
+        CHECK( seen.header.cmd == 200 and seen.header.value == 0x12345678 and seen.header.argc == sizes.size());
+        CHECK( seen.arguments == arguments);
+        CHECK( seen.in_order);
+        CHECK( seen.max_chunk > 0 and seen.max_chunk <= 120);
+        CHECK( esp.statistics().packets_received == before.packets_received + 1);
+
+        // all chunks are collected in the same receive buffer.
+        bool one_buffer = true;
+        for (auto buffer : seen.chunk_buffers) one_buffer = one_buffer and buffer == seen.chunk_buffers.front();
+        CHECK( one_buffer);
+
+        feed( check::slip_frame( raw, true));
+        CHECK( seen.begins == 1 and seen.ends == 1);
+        CHECK( not seen.valid);
+        CHECK( esp.statistics().crc_errors == before.crc_errors + 1);
+
+        // the slot is free again for regular frames.
+        uart.feed( check::esp_frame( 100, 7, { "small"}));
+        const esp_link::packet *p = nullptr;
+        while (uart.data_available() and not p) p = esp.try_receive();
+        CHECK( p and p->value == 7);
+        esp.release( p);
+    }
+
+    /// Frames that the handler refuses are dropped, as if there was no handler.
+    void check_refused()
+    {
+        const auto before = esp.statistics();
+        accept = false;
+        feed( check::esp_frame( 200, 1, make_arguments( { 300})));
+        accept = true;
+        CHECK( seen.begins == 1 and seen.ends == 0 and seen.arguments.empty());
+        CHECK( esp.statistics().dropped_frames == before.dropped_frames + 1);
+    }
+}
+
+int main()
+{
+    esp.set_stream_handler( &handler);
+
+    check_frame( { 4, 112});                // 130 bytes, the smallest padded frame that does not fit
+    check_frame( { 117}, false);            // 129 bytes
+    check_frame( { 117});
+    check_frame( { 120});                   // exactly one chunk
+    check_frame( { 121});                   // one byte more than a chunk
+    check_frame( { 119, 1, 240});           // chunks end at argument boundaries
+    check_frame( { 0, 300, 0, 5});          // empty arguments
+    check_frame( { 17, 33, 65, 129, 257});
+    check_frame( { 1, 1001}, false);        // 1016 bytes
+    check_frame( { 1006});                  // 1018 bytes
+    check_refused();
+    return check::result( "stream_check");
+}
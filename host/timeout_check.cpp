@@ -0,0 +1,168 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks, in simulated time, that the timeouts of receive() and receive_byte() expire
+ * on their deadline and not before.
+ */
+#include "esp-link/client.hpp"
+#include "check.hpp"
+
+#include <deque>
+#include <utility>
+
+#ifndef TIMING_FAKE_CLOCK
+#error "timeout_check must be built with the fake clock"
+#endif
+
+namespace
+{
+    using timing::fake_clock;
+
+    /**
+     * Transport whose received bytes arrive at given times. Every poll of data_available() takes
+     * poll_us of simulated time, like a busy loop on a real device would.
+     */
+    class timed_transport
+    {
+    public:
+        static constexpr uint32_t poll_us = 7;
+
+        void send( uint8_t)
+        {
+        }
+
+        void send( const char *)
+        {
+        }
+
+        bool data_available()
+        {
+            fake_clock::advance_us( poll_us);
+            return not m_received.empty()
+                    and static_cast<int32_t>( fake_clock::now_us() - m_received.front().first) >= 0;
+        }
+
+        uint8_t get()
+        {
+            if (m_received.empty()) return 0;
+            const uint8_t value = m_received.front().second;
+            m_received.pop_front();
+            return value;
+        }
+
+        uint8_t read()
+        {
+            return get();
+        }
+
+        /// let bytes arrive at time at_us.
+        void feed( uint32_t at_us, const std::vector<uint8_t> &bytes)
+        {
+            for (auto byte : bytes) m_received.emplace_back( at_us, byte);
+        }
+
+        void clear()
+        {
+            m_received.clear();
+        }
+
+    private:
+        std::deque<std::pair<uint32_t, uint8_t>> m_received;
+    };
+
+    timed_transport transport;
+    esp_link::basic_client<timed_transport> esp( transport);
+
+    /// Return whether a timeout that started at start_us and was detected now, expired on its deadline.
+    bool on_deadline( uint32_t start_us, uint32_t timeout_us)
+    {
+        const uint32_t elapsed = fake_clock::now_us() - start_us;
+        return elapsed >= timeout_us and elapsed <= timeout_us + timed_transport::poll_us;
+    }
+
+    void check_receive_timeout( uint32_t start_us)
+    {
+        fake_clock::set_us( start_us);
+        CHECK( esp.receive( 500) == nullptr);
+        CHECK( on_deadline( start_us, 500000));
+
+        fake_clock::set_us( start_us);
+        CHECK( esp.receive( 1) == nullptr);
+        CHECK( on_deadline( start_us, 1000));
+    }
+
+    /// A packet that is complete just before the deadline is returned, one that is complete after it is not.
+    void check_receive_deadline()
+    {
+        const uint32_t start_us = 3000000;
+        const auto frame = check::esp_frame( 100, 42);
+
+        fake_clock::set_us( start_us);
+        transport.feed( start_us + 499000, frame);
+        auto p = esp.receive( 500);
+        CHECK( p != nullptr and p->value == 42);
+        esp.release( p);
+
+        fake_clock::set_us( start_us);
+        transport.feed( start_us + 500100, frame);
+        CHECK( esp.receive( 500) == nullptr);
+        CHECK( on_deadline( start_us, 500000));
+
+        // the late packet is still received afterwards.
+        p = esp.receive( 1);
+        CHECK( p != nullptr and p->value == 42);
+        esp.release( p);
+        transport.clear();
+    }
+
+    void check_receive_byte()
+    {
+        const uint32_t start_us = 5000321;
+        uint8_t value = 0;
+
+        fake_clock::set_us( start_us);
+        CHECK( not esp.receive_byte( value));
+        CHECK( on_deadline( start_us, 125000));
+
+        fake_clock::set_us( start_us);
+        CHECK( not esp.receive_byte( value, 300));
+        CHECK( on_deadline( start_us, 300));
+
+        fake_clock::set_us( start_us);
+        transport.feed( start_us + 290, { 0x55});
+        CHECK( esp.receive_byte( value, 300) and value == 0x55);
+
+        fake_clock::set_us( start_us);
+        transport.feed( start_us + 310, { 0x66});
+        CHECK( not esp.receive_byte( value, 300));
+        CHECK( on_deadline( start_us, 300));
+        transport.clear();
+
+        // an escape sequence must be complete before the deadline of the whole byte.
+        fake_clock::set_us( start_us);
+        transport.feed( start_us + 100, { esp_link::detail::SLIP_ESC});
+        transport.feed( start_us + 290, { esp_link::detail::SLIP_ESC_END});
+        CHECK( esp.receive_byte( value, 300) and value == esp_link::detail::SLIP_END);
+
+        fake_clock::set_us( start_us);
+        transport.feed( start_us + 100, { esp_link::detail::SLIP_ESC});
+        transport.feed( start_us + 310, { esp_link::detail::SLIP_ESC_ESC});
+        CHECK( not esp.receive_byte( value, 300));
+        CHECK( on_deadline( start_us, 300));
+        transport.clear();
+    }
+}
+
+int main()
+{
+    check_receive_timeout( 1000000);    // on a millisecond boundary
+    check_receive_timeout( 2000999);    // just before one
+    check_receive_deadline();
+    check_receive_byte();
+    return check::result( "timeout_check");
+}
@@ -0,0 +1,157 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Checks of the trace events that the client records, in simulated time.
+ *
+ * The Makefile builds this twice: with TRACE_LEVEL=3, where every event is recorded, and
+ * with TRACE_LEVEL=1, where only errors are.
+ */
+#include "esp-link/client.hpp"
+#include "check.hpp"
+
+#include <avr_utilities/devices/uart.h>
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#if TRACE_LEVEL == TRACE_LEVEL_OFF
+#error "trace_check must be built with tracing enabled"
+#endif
+
+namespace
+{
+    using namespace esp_link::trace_events;
+    using timing::fake_clock;
+
+    serial::uart<> uart;
+    esp_link::client esp( uart);
+
+    struct expected_event
+    {
+        uint8_t     level;
+        uint8_t     id;
+        uint16_t    value;
+        uint16_t    time;
+    };
+
+    std::vector<expected_event> expected;
+
+    void feed( const std::vector<uint8_t> &frame)
+    {
+        uart.feed( frame);
+        while (uart.data_available()) esp.release( esp.try_receive());
+    }
+
+    /// The events that the current trace level records.
+    std::vector<expected_event> recorded()
+    {
+        std::vector<expected_event> result;
+        for (const auto &e : expected)
+        {
+            if (e.level <= TRACE_LEVEL) result.push_back( e);
+        }
+        return result;
+    }
+
+    /// Let the client record some events of every kind, at distinct times.
+    void record_events()
+    {
+        fake_clock::set_us( 1000000);
+        esp.connect();
+        expected.push_back( { TRACE_LEVEL_INFO, sync, 0, 1000});
+
+        fake_clock::advance_ms( 5);
+        feed( check::esp_frame( 100, 1));
+        expected.push_back( { TRACE_LEVEL_DEBUG, packet, 100, 1005});
+
+        fake_clock::advance_ms( 5);
+        const auto corrupt = check::esp_frame( 101, 1, { "abc"}, true);
+        feed( corrupt);
+        expected.push_back( { TRACE_LEVEL_ERROR, crc_error, 16, 1010});
+
+        fake_clock::advance_ms( 5);
+        feed( check::esp_frame( 102, 1, { std::string( 200, 'x')}));
+        expected.push_back( { TRACE_LEVEL_ERROR, frame_dropped, 0, 1015});
+
+        fake_clock::advance_ms( 5);
+        feed( check::esp_frame( esp_link::commands::CMD_RESP_CB, 0x1234));
+        expected.push_back( { TRACE_LEVEL_DEBUG, packet, esp_link::commands::CMD_RESP_CB, 1020});
+        expected.push_back( { TRACE_LEVEL_INFO, unknown_callback, 0x1234, 1020});
+    }
+
+    void check_events()
+    {
+        const auto events = recorded();
+        CHECK( trace::size() == events.size());
+        for (uint8_t index = 0; index < trace::size() and index < events.size(); ++index)
+        {
+            const auto &e = trace::at( index);
+            CHECK( e.id == events[index].id and e.value == events[index].value and e.time == events[index].time);
+        }
+    }
+
+    /// The published trace holds every event as 5 little-endian bytes, oldest first.
+    void check_publish()
+    {
+        std::string data;
+        for (const auto &e : recorded())
+        {
+            const uint8_t bytes[] = {
+                    static_cast<uint8_t>( e.time), static_cast<uint8_t>( e.time >> 8),
+                    static_cast<uint8_t>( e.value), static_cast<uint8_t>( e.value >> 8), e.id};
+            data.append( reinterpret_cast<const char *>( bytes), sizeof bytes);
+        }
+        const char length[] = { static_cast<char>( data.size()), static_cast<char>( data.size() >> 8)};
+
+        uart.clear_transmitted();
+        esp_link::publish_trace( esp, "/spider/trace");
+        CHECK( uart.transmitted() == check::esp_frame( esp_link::commands::CMD_MQTT_PUBLISH, 0,
+                { "/spider/trace", data, std::string( length, 2), std::string( 1, '\0'), std::string( 1, '\0')}));
+    }
+
+    void check_print()
+    {
+        FILE *output = tmpfile();
+        trace::print( output);
+        rewind( output);
+        unsigned lines = 0;
+        char line[80];
+        while (fgets( line, sizeof line, output)) ++lines;
+        fclose( output);
+        CHECK( lines == trace::size());
+    }
+
+    /// The buffer keeps the most recent TRACE_BUFFER_SIZE events.
+    void check_wrap_around()
+    {
+        trace::clear();
+        CHECK( trace::size() == 0);
+        for (uint16_t count = 0; count < TRACE_BUFFER_SIZE + 3; ++count)
+        {
+            fake_clock::advance_ms( 1);
+            TRACE_ERROR( 200, count);
+        }
+        CHECK( trace::size() == TRACE_BUFFER_SIZE);
+        CHECK( trace::at( 0).value == 3);
+        CHECK( trace::at( TRACE_BUFFER_SIZE - 1).value == TRACE_BUFFER_SIZE + 2);
+    }
+}
+
+int main()
+{
+    record_events();
+    check_events();
+    check_publish();
+    check_print();
+    check_wrap_around();
+
+    char name[32];
+    snprintf( name, sizeof name, "trace_check (level %d)", TRACE_LEVEL);
+    return check::result( name);
+}
@@ -0,0 +1,217 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SCHEDULER_SCHEDULER_HPP_
+#define SCHEDULER_SCHEDULER_HPP_
+#include <stdint.h>
+#include "function/function.hpp"
+
+namespace scheduler
+{
+    /**
+     * A cooperative scheduler with timers and polled tasks.
+     *
+     * Timers call a function once (after()) or repeatedly (every()) at a given time.
+     * Tasks are called on every iteration of the main loop, they are meant for event
+     * sources, like the esp-link client, that need to check for input often and that
+     * return quickly if there is nothing to do.
+     *
+     * The scheduler never preempts anything: a timer or task that takes a long time
+     * delays everything else. To find such culprits, the scheduler keeps track of
+     * the longest time (in microseconds) that every timer and task took.
+     *
+     * Clock must provide static now_ms() and now_us() functions, @see timing::timer0_clock and
+     * timing::fake_clock.
+     *
+     * A timer id consists of the position of the timer (lowest byte) and the generation of that
+     * position (highest byte). The generation changes every time a timer stops, so that the id of a
+     * timer that has expired or was cancelled does not refer to a later timer at the same position.
+     */
+    template< typename Clock, uint8_t TimerCount, uint8_t TaskCount>
+    class scheduler
+    {
+    public:
+        static_assert( TimerCount < 0xff, "a scheduler can have at most 254 timers");
+
+        using callback_type = function::function<void ()>;
+        using id_type       = uint8_t;
+        using timer_id      = uint16_t;
+
+        static constexpr id_type  invalid_id    = 0xff;
+        static constexpr timer_id invalid_timer = 0xffff;
+
+        /**
+         * Call a function once, after the given number of milliseconds.
+         *
+         * Returns an id for the timer, which can be used to cancel it, or invalid_timer
+         * if there is no free timer.
+         */
+        timer_id after( uint32_t milliseconds, callback_type f)
+        {
+            return start_timer( milliseconds, 0, f);
+        }
+
+        /**
+         * Call a function every given number of milliseconds, starting one period from now.
+         */
+        timer_id every( uint32_t milliseconds, callback_type f)
+        {
+            return start_timer( milliseconds, milliseconds, f);
+        }
+
+        /**
+         * Stop a timer. Cancelling a timer that has already expired or that was
+         * cancelled before is harmless, even if its position is in use by another timer by now.
+         */
+        void cancel( timer_id id)
+        {
+            const uint8_t index = id & 0xff;
+            if (index < TimerCount and m_timers[index].f and m_timers[index].generation == id >> 8)
+            {
+                stop( m_timers[index]);
+            }
+        }
+
+        /**
+         * Add a task that will be called on every iteration of the main loop.
+         *
+         * Returns an id for the task or invalid_id if there are no free task slots.
+         */
+        id_type add_task( callback_type f)
+        {
+            for (id_type id = 0; id < TaskCount; ++id)
+            {
+                if (!m_tasks[id].f)
+                {
+                    m_tasks[id].f = f;
+                    m_tasks[id].max_us = 0;
+                    return id;
+                }
+            }
+            return invalid_id;
+        }
+
+        void remove_task( id_type task)
+        {
+            if (task < TaskCount) m_tasks[task].f = callback_type{};
+        }
+
+        /**
+         * Run all timers that are due and then all tasks, once.
+         */
+        void run_once()
+        {
+            const uint32_t now = Clock::now_ms();
+            for (auto &timer : m_timers)
+            {
+                if (timer.f and static_cast<int32_t>( now - timer.due) >= 0)
+                {
+                    callback_type f = timer.f;
+                    if (timer.period)
+                    {
+                        timer.due += timer.period;
+                        // don't try to catch up if we're more than a period late
+                        if (static_cast<int32_t>( now - timer.due) >= 0) timer.due = now + timer.period;
+                    }
+                    else
+                    {
+                        stop( timer);
+                    }
+                    timed_call( f, timer.max_us);
+                }
+            }
+
+            for (auto &task : m_tasks)
+            {
+                if (task.f)
+                {
+                    callback_type f = task.f;
+                    timed_call( f, task.max_us);
+                }
+            }
+        }
+
+        /// Run forever.
+        void run()
+        {
+            for (;;) run_once();
+        }
+
+        /// Longest run time of a timer callback, in microseconds.
+        uint16_t timer_max_us( timer_id id) const
+        {
+            const uint8_t index = id & 0xff;
+            return index < TimerCount ? m_timers[index].max_us : 0;
+        }
+
+        /// Longest run time of a task, in microseconds.
+        uint16_t task_max_us( id_type task) const
+        {
+            return task < TaskCount ? m_tasks[task].max_us : 0;
+        }
+
+        /// Forget all run time measurements.
+        void reset_statistics()
+        {
+            for (auto &timer : m_timers) timer.max_us = 0;
+            for (auto &task  : m_tasks)  task.max_us  = 0;
+        }
+
+    private:
+        timer_id start_timer( uint32_t delay, uint32_t period, callback_type f)
+        {
+            for (uint8_t index = 0; index < TimerCount; ++index)
+            {
+                auto &timer = m_timers[index];
+                if (!timer.f)
+                {
+                    timer.f      = f;
+                    timer.due    = Clock::now_ms() + delay;
+                    timer.period = period;
+                    timer.max_us = 0;
+                    return static_cast<timer_id>( timer.generation) << 8 | index;
+                }
+            }
+            return invalid_timer;
+        }
+
+        static void timed_call( callback_type &f, uint16_t &max_us)
+        {
+            const uint32_t start = Clock::now_us();
+            f();
+            const uint32_t elapsed = Clock::now_us() - start;
+            if (elapsed > max_us) max_us = elapsed > 0xffff ? 0xffff : elapsed;
+        }
+
+        struct timer
+        {
+            callback_type   f;
+            uint32_t        due     = 0;
+            uint32_t        period  = 0;
+            uint16_t        max_us  = 0;
+            uint8_t         generation = 0;
+        };
+
+        struct task
+        {
+            callback_type   f;
+            uint16_t        max_us  = 0;
+        };
+
+        /// free the position of a timer and make sure that its id does not match the next timer there.
+        static void stop( timer &t)
+        {
+            t.f = callback_type{};
+            ++t.generation;
+        }
+
+        timer   m_timers[TimerCount];
+        task    m_tasks[TaskCount];
+    };
+}
+
+#endif /* SCHEDULER_SCHEDULER_HPP_ */
@@ -7,11 +7,17 @@
 //
 
 #include "esp-link/client.hpp"
+#include "esp-link/connection_tracker.hpp"
+#include "esp-link/mqtt_router.hpp"
+#include "esp-link/publish_queue.hpp"
+#include "esp-link/tx_interrupt.hpp"
+#include "scheduler/scheduler.hpp"
+#include "timing/clock.hpp"
 #include "avr_utilities/pin_definitions.hpp"
 #include "avr_utilities/devices/uart.h"
 #include <avr_utilities/flash_string.hpp>
 
-#include <util/delay.h>
+#include <avr/interrupt.h>
 #include <stdlib.h>
 
 PIN_TYPE( B, 6) led;
@@ -23,6 +29,16 @@ serial::uart<> uart(19200);
 IMPLEMENT_UART_INTERRUPT( uart);
 
 esp_link::client esp( uart);
+IMPLEMENT_ESP_LINK_TX_INTERRUPT( esp);
+
+esp_link::connection_tracker<esp_link::client> broker( esp);
+
+// messages that are published while the broker is unreachable wait here, the
+// first 512 bytes of the EEPROM take the overflow.
+esp_link::publish_queue< esp_link::client, 2, 40, esp_link::eeprom_store<0, 512>> outbox( esp);
+
+IMPLEMENT_TIMER0_CLOCK_INTERRUPT();
+scheduler::scheduler< timing::clock, 4, 2> tasks;
 
 char *digits( uint8_t value)
 {
@@ -60,32 +76,85 @@ void clear_uart()
     while (uart.data_available()) uart.get();
 }
 
-void update( const esp_link::packet *p)
+void on_led( const esp_link::packet *p)
 {
     toggle( led);
 }
 
-int main(void)
+using topics = esp_link::mqtt::router<
+        esp_link::mqtt::route< ESP_LINK_STRING_T( "/spider/LED"), &on_led>
+        >;
+
+/**
+ * Task: handle everything that the esp-link sends.
+ */
+void poll_esp()
 {
-    using esp_link::mqtt::setup;
-    using esp_link::mqtt::subscribe;
+    esp.release( esp.try_receive());
+}
 
-    make_output( led);
+void subscribe_topics()
+{
+    topics::subscribe_all( esp);
+}
+
+/**
+ * Task: send messages that were queued while the link was down.
+ */
+void poll_outbox()
+{
+    outbox.poll();
+}
+
+void publish_link_statistics()
+{
+    uint8_t buffer[esp_link::link_statistics::serialized_size];
+    esp.statistics().serialize( buffer);
+    outbox.publish( F_("/spider/link"), esp_link::span( buffer));
+}
+
+/**
+ * Called whenever the link with the esp-link comes up, which includes
+ * every time the esp-link restarts.
+ */
+void on_link_up()
+{
+    broker.start( topics::dispatcher( esp));
+}
+
+/**
+ * Called when the esp-link connects to or disconnects from the MQTT broker.
+ * Subscriptions do not survive a new broker connection, so renew them.
+ */
+void on_broker_change( bool reachable)
+{
+    if (reachable) subscribe_topics();
+}
 
-    // get startup logging of the uart out of the way.
-    _delay_ms( 5000); // wait for an eternity.
-    clear_uart();    // then clear everything received on uart.
+void start_esp()
+{
+    clear_uart();    // clear everything received on uart during esp startup.
+
+    esp.on_link_up( &on_link_up);
+    broker.on_change( &on_broker_change);
+    outbox.send_when( []{ return broker.broker_reachable();});
+    esp.connect();
+    tasks.add_task( &poll_esp);
+    tasks.add_task( &poll_outbox);
+    tasks.every( 60000, &publish_link_statistics);
+}
 
-    while (not esp.sync()) toggle( led);
+int main(void)
+{
+    make_output( led);
 
-    esp.execute( setup, nullptr, nullptr, nullptr, &update);
-    _delay_ms( 5000);
+    timing::clock::init();
+    outbox.restore();
+    sei();
 
-    //esp.execute( subscribe, "/spider/LED", 0);
-    esp.execute( subscribe, F_("/spider/LED"), 0);
+    // get startup logging of the uart out of the way
+    // by waiting for an eternity before starting.
+    tasks.after( 5000, &start_esp);
 
-    for(;;)
-    {
-        esp.try_receive();
-    }
+    tasks.run();
 }
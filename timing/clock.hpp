@@ -0,0 +1,38 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef TIMING_CLOCK_HPP_
+#define TIMING_CLOCK_HPP_
+
+/**
+ * Selection of the system clock, timing::clock.
+ *
+ * On the AVR this is the timer 0 clock. On the host it follows real time, unless
+ * TIMING_FAKE_CLOCK is defined, in which case time only moves when the host code
+ * advances the fake clock.
+ */
+#if defined( __AVR__)
+#include "timer0_clock.hpp"
+namespace timing
+{
+    using clock = timer0_clock;
+}
+#elif defined( TIMING_FAKE_CLOCK)
+#include "fake_clock.hpp"
+namespace timing
+{
+    using clock = fake_clock;
+}
+#else
+#include "host_clock.hpp"
+namespace timing
+{
+    using clock = host_clock;
+}
+#endif
+
+#endif /* TIMING_CLOCK_HPP_ */
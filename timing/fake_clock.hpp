@@ -0,0 +1,61 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef TIMING_FAKE_CLOCK_HPP_
+#define TIMING_FAKE_CLOCK_HPP_
+#include <stdint.h>
+
+namespace timing
+{
+    /**
+     * Clock with the same interface as timer0_clock, but that only moves when told to.
+     *
+     * This makes code that depends on time (timeouts, timers) deterministic in host
+     * tests and benchmarks.
+     */
+    class fake_clock
+    {
+    public:
+        static void init()
+        {
+        }
+
+        static uint32_t now_ms()
+        {
+            return microseconds() / 1000;
+        }
+
+        static uint32_t now_us()
+        {
+            return microseconds();
+        }
+
+        static void set_us( uint32_t us)
+        {
+            microseconds() = us;
+        }
+
+        static void advance_us( uint32_t us)
+        {
+            microseconds() += us;
+        }
+
+        static void advance_ms( uint32_t ms)
+        {
+            advance_us( ms * 1000);
+        }
+
+    private:
+        static uint32_t &microseconds()
+        {
+            static uint32_t us = 0;
+            return us;
+        }
+    };
+}
+
+#endif /* TIMING_FAKE_CLOCK_HPP_ */
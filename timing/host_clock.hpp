@@ -0,0 +1,53 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef TIMING_HOST_CLOCK_HPP_
+#define TIMING_HOST_CLOCK_HPP_
+#include <stdint.h>
+#include <chrono>
+
+namespace timing
+{
+    /**
+     * Clock with the same interface as timer0_clock, for host builds, that follows real time.
+     */
+    class host_clock
+    {
+    public:
+        static void init()
+        {
+            start();
+        }
+
+        static uint32_t now_ms()
+        {
+            return elapsed<std::chrono::milliseconds>();
+        }
+
+        static uint32_t now_us()
+        {
+            return elapsed<std::chrono::microseconds>();
+        }
+
+    private:
+        using clock_type = std::chrono::steady_clock;
+
+        static clock_type::time_point start()
+        {
+            static const clock_type::time_point start_time = clock_type::now();
+            return start_time;
+        }
+
+        template< typename Unit>
+        static uint32_t elapsed()
+        {
+            return static_cast<uint32_t>( std::chrono::duration_cast<Unit>( clock_type::now() - start()).count());
+        }
+    };
+}
+
+#endif /* TIMING_HOST_CLOCK_HPP_ */
@@ -0,0 +1,91 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef TIMING_TIMER0_CLOCK_HPP_
+#define TIMING_TIMER0_CLOCK_HPP_
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+namespace timing
+{
+    /**
+     * Monotonic clock, driven by timer 0 of the AVR.
+     *
+     * Timer 0 runs in CTC mode with a prescaler of 64 and generates an interrupt every millisecond.
+     * The interrupt handler increments a millisecond counter. Microseconds are derived from
+     * that counter plus the current timer count, with a resolution of 64 CPU clock cycles
+     * (8us at 8Mhz).
+     *
+     * init() must be called and interrupts must be enabled for the clock to run. The
+     * interrupt handler is created with IMPLEMENT_TIMER0_CLOCK_INTERRUPT(), which must
+     * appear exactly once in the firmware.
+     */
+    class timer0_clock
+    {
+    public:
+        static constexpr uint32_t prescaler     = 64;
+        static constexpr uint32_t counts_per_ms = F_CPU / prescaler / 1000;
+        static constexpr uint16_t us_per_count  = 1000 / counts_per_ms;
+
+        static_assert( counts_per_ms <= 256, "CPU clock too fast for a 1ms timer 0 interrupt");
+        static_assert( F_CPU % (prescaler * 1000) == 0, "CPU clock should be a multiple of 64kHz");
+
+        static void init()
+        {
+            TCCR0A = _BV( WGM01);               // CTC mode
+            OCR0A  = counts_per_ms - 1;
+            TIMSK0 |= _BV( OCIE0A);
+            TCCR0B = _BV( CS01) | _BV( CS00);   // prescaler 64
+        }
+
+        /// milliseconds since init()
+        static uint32_t now_ms()
+        {
+            uint32_t result;
+            ATOMIC_BLOCK( ATOMIC_RESTORESTATE)
+            {
+                result = m_milliseconds;
+            }
+            return result;
+        }
+
+        /// microseconds since init(). This wraps around after about 71 minutes.
+        static uint32_t now_us()
+        {
+            uint32_t ms;
+            uint8_t  count;
+            ATOMIC_BLOCK( ATOMIC_RESTORESTATE)
+            {
+                ms    = m_milliseconds;
+                count = TCNT0;
+                // the counter may have wrapped without the interrupt having run yet.
+                if ((TIFR0 & _BV( OCF0A)) and count < counts_per_ms - 1) ++ms;
+            }
+            return ms * 1000 + count * us_per_count;
+        }
+
+        /// to be called from the timer interrupt only.
+        static void on_tick()
+        {
+            ++m_milliseconds;
+        }
+
+    private:
+        static volatile uint32_t m_milliseconds;
+    };
+}
+
+#define IMPLEMENT_TIMER0_CLOCK_INTERRUPT()                  \
+volatile uint32_t timing::timer0_clock::m_milliseconds = 0; \
+ISR( TIMER0_COMPA_vect)                                     \
+{                                                           \
+    timing::timer0_clock::on_tick();                        \
+}
+
+#endif /* TIMING_TIMER0_CLOCK_HPP_ */
@@ -0,0 +1,156 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef TRACE_TRACE_HPP_
+#define TRACE_TRACE_HPP_
+
+/**
+ * Compile-time selectable tracing into a ring buffer in RAM.
+ *
+ * Code records events with the TRACE_ERROR(), TRACE_INFO() and TRACE_DEBUG() macros.
+ * An event is an 8-bit id, a 16-bit value and the time (lower 16 bits of the millisecond clock)
+ * at which it was recorded. The most recent TRACE_BUFFER_SIZE events are kept.
+ * The buffer can be printed (on the host) or published over MQTT, @see esp_link::publish_trace().
+ *
+ * TRACE_LEVEL selects which macros record anything:
+ * 0 (the default) disables tracing completely, 1 records errors, 2 also records informational
+ * events and 3 records everything. Macros above the selected level expand to nothing, so their
+ * arguments are not even evaluated.
+ *
+ * Events are recorded from the main loop, recording from interrupt handlers is not supported.
+ */
+#define TRACE_LEVEL_OFF   0
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_INFO  2
+#define TRACE_LEVEL_DEBUG 3
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_OFF
+#endif
+
+/// Number of events in the trace buffer, must be a power of two and at most 128.
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 16
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR( id, value) ::trace::record( (id), (value))
+#else
+#define TRACE_ERROR( id, value) do {} while (0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO( id, value) ::trace::record( (id), (value))
+#else
+#define TRACE_INFO( id, value) do {} while (0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG( id, value) ::trace::record( (id), (value))
+#else
+#define TRACE_DEBUG( id, value) do {} while (0)
+#endif
+
+#include "timing/clock.hpp"
+#include <stdint.h>
+#ifndef __AVR__
+#include <stdio.h>
+#endif
+
+namespace trace
+{
+    struct event
+    {
+        uint16_t    time;   ///< lower 16 bits of the millisecond clock
+        uint16_t    value;
+        uint8_t     id;
+
+        /// size of an event when serialized
+        static constexpr uint8_t serialized_size = 5;
+
+        /// return byte 'index' of the serialized (little-endian: time, value, id) form of this event
+        uint8_t serialized( uint8_t index) const
+        {
+            switch (index)
+            {
+            case 0:  return time;
+            case 1:  return time >> 8;
+            case 2:  return value;
+            case 3:  return value >> 8;
+            default: return id;
+            }
+        }
+    };
+
+    namespace detail
+    {
+        static_assert( TRACE_BUFFER_SIZE > 0 and TRACE_BUFFER_SIZE <= 128
+                and (TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0,
+                "TRACE_BUFFER_SIZE must be a power of two, at most 128");
+
+        // a template only to have the buffer defined in this header. The buffer only takes
+        // up memory if something is traced.
+        template< typename = void>
+        struct buffer
+        {
+            static event    events[TRACE_BUFFER_SIZE];
+            static uint8_t  next;   ///< position of the next event
+            static uint8_t  used;   ///< number of positions that hold an event
+        };
+
+        template< typename T>
+        event buffer<T>::events[TRACE_BUFFER_SIZE];
+
+        template< typename T>
+        uint8_t buffer<T>::next = 0;
+
+        template< typename T>
+        uint8_t buffer<T>::used = 0;
+    }
+
+    /// Record an event, this overwrites the oldest event if the buffer is full.
+    inline void record( uint8_t id, uint16_t value)
+    {
+        using buffer = detail::buffer<>;
+        buffer::events[buffer::next] = event{ static_cast<uint16_t>( timing::clock::now_ms()), value, id};
+        buffer::next = (buffer::next + 1) & (TRACE_BUFFER_SIZE - 1);
+        if (buffer::used < TRACE_BUFFER_SIZE) ++buffer::used;
+    }
+
+    /// Number of events in the trace buffer.
+    inline uint8_t size()
+    {
+        return detail::buffer<>::used;
+    }
+
+    /// Return the event at position index, where index 0 is the oldest event in the buffer.
+    inline const event &at( uint8_t index)
+    {
+        using buffer = detail::buffer<>;
+        return buffer::events[(buffer::next - buffer::used + index) & (TRACE_BUFFER_SIZE - 1)];
+    }
+
+    /// Remove all events from the buffer.
+    inline void clear()
+    {
+        detail::buffer<>::used = 0;
+    }
+
+#ifndef __AVR__
+    /// Print the trace buffer, oldest event first.
+    inline void print( FILE *output = stdout)
+    {
+        for (uint8_t index = 0; index < size(); ++index)
+        {
+            const event &e = at( index);
+            fprintf( output, "%5u ms  event %3u  value %u\n", e.time, e.id, e.value);
+        }
+    }
+#endif
+}
+
+#endif /* TRACE_TRACE_HPP_ */